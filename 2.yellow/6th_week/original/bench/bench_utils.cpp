@@ -0,0 +1,67 @@
+#include "bench_utils.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+using namespace std;
+
+namespace {
+  // every block is prefixed with its size so that delete can account for it
+  const size_t HEADER_SIZE = alignof(max_align_t);
+  atomic<size_t> allocated_bytes = 0;
+  atomic<size_t> peak_allocated_bytes = 0;
+}
+
+void* operator new(size_t size) {
+  void* block = malloc(size + HEADER_SIZE);
+  if (!block) {
+    throw bad_alloc();
+  }
+  *static_cast<size_t*>(block) = size;
+  const size_t now_allocated = allocated_bytes += size;
+  size_t peak = peak_allocated_bytes;
+  while (now_allocated > peak && !peak_allocated_bytes.compare_exchange_weak(peak, now_allocated)) {
+  }
+  return static_cast<char*>(block) + HEADER_SIZE;
+}
+
+void operator delete(void* ptr) noexcept {
+  if (ptr) {
+    void* block = static_cast<char*>(ptr) - HEADER_SIZE;
+    allocated_bytes -= *static_cast<size_t*>(block);
+    free(block);
+  }
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  operator delete(ptr);
+}
+
+size_t AllocatedBytes() {
+  return allocated_bytes;
+}
+
+size_t PeakAllocatedBytes() {
+  return peak_allocated_bytes;
+}
+
+void ResetPeakAllocatedBytes() {
+  peak_allocated_bytes = allocated_bytes.load();
+}
+
+vector<Entry> GenerateEntries(size_t count, int date_count, int event_count) {
+  mt19937 gen(20171118);
+  uniform_int_distribution<int> day(0, date_count - 1);
+  uniform_int_distribution<int> event(0, event_count - 1);
+
+  vector<Entry> result;
+  result.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    const int d = day(gen);
+    result.push_back({{2000 + d / 372, d / 31 % 12 + 1, d % 31 + 1},
+                      "some event number " + to_string(event(gen))});
+  }
+  return result;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "database.h"
+
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+// Bytes currently allocated through operator new
+size_t AllocatedBytes();
+// The largest AllocatedBytes since the last reset
+size_t PeakAllocatedBytes();
+void ResetPeakAllocatedBytes();
+
+// count entries spread over date_count consecutive days
+// with event names drawn from event_count distinct strings
+vector<Entry> GenerateEntries(size_t count, int date_count, int event_count);
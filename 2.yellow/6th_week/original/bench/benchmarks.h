@@ -0,0 +1,11 @@
+#pragma once
+
+void BenchmarkColumnarDatabase();
+void BenchmarkCommandReader();
+void BenchmarkDatabaseStorage();
+void BenchmarkDateRange();
+void BenchmarkEventIndex();
+void BenchmarkFindCursor();
+void BenchmarkLast();
+void BenchmarkOutputWriter();
+void BenchmarkParallelScan();
@@ -0,0 +1,57 @@
+#include "benchmarks.h"
+#include "bench_utils.h"
+#include "columnar_database.h"
+#include "database.h"
+#include "profile.h"
+
+#include <iostream>
+#include <sstream>
+using namespace std;
+
+template <typename DB>
+void BenchmarkStorage(const string& name, const vector<Entry>& entries) {
+  const size_t memory_before = AllocatedBytes();
+  DB db;
+  {
+    LOG_DURATION(name + " add");
+    for (const auto& e : entries) {
+      db.Add(e.date, e.event);
+    }
+  }
+  const size_t memory = AllocatedBytes() - memory_before;
+  size_t found;
+  int removed;
+  {
+    LOG_DURATION(name + " find");
+    found = db.Findif ([](const Date& date, const string&) { return date.month == 1; }).size();
+  }
+  {
+    LOG_DURATION(name + " print");
+    ostringstream os;
+    db.Print(os);
+  }
+  {
+    LOG_DURATION(name + " remove");
+    removed = db.Removeif ([](const Date& date, const string&) { return date.day == 1; });
+  }
+  cerr << name << ": " << memory / entries.size() << " bytes per event, "
+       << found << " found, " << removed << " removed" << endl;
+}
+
+void BenchmarkColumnarDatabase() {
+  for (int event_count : {1'000, 1'000'000}) {
+    const auto entries = GenerateEntries(2'000'000, 3650, event_count);
+    cerr << "2M events, 3650 dates, " << event_count << " distinct events" << endl;
+    BenchmarkStorage<Database>("map<Date, EventSet>", entries);
+    BenchmarkStorage<ColumnarDatabase>("ColumnarDatabase", entries);
+  }
+
+  // every entry has a date of its own, the latest comes first
+  vector<Entry> entries;
+  for (int key = DateToKey({2999, 12, 31}); entries.size() < 500'000; --key) {
+    entries.push_back({KeyToDate(key), "event"});
+  }
+  cerr << "500K events in reverse order of dates" << endl;
+  BenchmarkStorage<Database>("map<Date, EventSet>", entries);
+  BenchmarkStorage<ColumnarDatabase>("ColumnarDatabase", entries);
+}
@@ -0,0 +1,78 @@
+#include "benchmarks.h"
+#include "bench_utils.h"
+#include "command_reader.h"
+#include "condition_parser.h"
+#include "date.h"
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+using namespace std;
+using namespace std::chrono;
+
+// Command log of Add lines with a Find after every 100 of them
+string GenerateCommandLog(size_t add_count) {
+  ostringstream os;
+  size_t i = 0;
+  for (const auto& e : GenerateEntries(add_count, 3650, 100'000)) {
+    os << "Add " << e.date << ' ' << e.event << '\n';
+    if (++i % 100 == 0) {
+      os << "Find date >= " << e.date << R"( AND event != ")" << e.event << "\"\n";
+    }
+  }
+  return os.str();
+}
+
+// The parsing main.cpp did before CommandReader
+size_t ParseWithStreams(const string& log) {
+  istringstream input(log);
+  size_t checksum = 0;
+  for (string line; getline(input, line); ) {
+    istringstream is(line);
+    string command;
+    is >> command;
+    if (command == "Add") {
+      checksum += ParseDate(is).day;
+      while (isspace(is.peek())) {
+        is.ignore();
+      }
+      string event;
+      getline(is, event);
+      checksum += event.size();
+    } else if (command == "Find") {
+      checksum += ParseCondition(is)->Evaluate({2017, 1, 1}, "");
+    }
+  }
+  return checksum;
+}
+
+size_t ParseWithReader(const string& log) {
+  istringstream input(log);
+  CommandReader reader(input);
+  size_t checksum = 0;
+  for (string_view line; reader.ReadLine(line); ) {
+    const string_view command = ReadWord(line);
+    if (command == "Add") {
+      checksum += ParseDate(line).day;
+      checksum += ParseEvent(line).size();
+    } else if (command == "Find") {
+      checksum += ParseCondition(line)->Evaluate({2017, 1, 1}, "");
+    }
+  }
+  return checksum;
+}
+
+template <typename Parser>
+void MeasureThroughput(const string& name, const string& log, Parser parser) {
+  const auto start = steady_clock::now();
+  const size_t checksum = parser(log);
+  const double seconds = duration<double>(steady_clock::now() - start).count();
+  cerr << name << ": " << log.size() / seconds / (1 << 20) << " MB/s (checksum " << checksum << ")" << endl;
+}
+
+void BenchmarkCommandReader() {
+  const string log = GenerateCommandLog(4'000'000);
+  cerr << "command log of " << log.size() / (1 << 20) << " MB" << endl;
+  MeasureThroughput("getline and istringstream", log, ParseWithStreams);
+  MeasureThroughput("command reader", log, ParseWithReader);
+}
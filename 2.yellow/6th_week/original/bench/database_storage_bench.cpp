@@ -0,0 +1,63 @@
+#include "benchmarks.h"
+#include "bench_utils.h"
+#include "command_reader.h"
+#include "database_storage.h"
+#include "profile.h"
+
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+using namespace std;
+
+// Cold start of a database: replaying text commands, replaying the binary log
+// and loading a snapshot of the same entries
+void BenchmarkDatabaseStorage() {
+  const size_t entry_count = 5'000'000;
+  const auto entries = GenerateEntries(entry_count, 3650, 100'000);
+  const string path = (filesystem::temp_directory_path() / "database_storage_bench").string();
+  filesystem::remove(path + ".snapshot");
+
+  ostringstream commands;
+  {
+    Database db;
+    DatabaseStorage storage(path);
+    storage.Load(db);
+    for (const auto& e : entries) {
+      commands << "Add " << e.date << ' ' << e.event << '\n';
+      storage.LogAdd(e.date, e.event);
+    }
+    storage.Flush();
+  }
+  cerr << entry_count << " entries: " << commands.str().size() / (1 << 20) << " MB of commands, "
+       << filesystem::file_size(path + ".log") / (1 << 20) << " MB of log" << endl;
+  {
+    LOG_DURATION("replay commands");
+    istringstream is(commands.str());
+    CommandReader reader(is);
+    Database db;
+    for (string_view line; reader.ReadLine(line); ) {
+      ReadWord(line);
+      const Date date = ParseDate(line);
+      db.Add(date, string(ParseEvent(line)));
+    }
+  }
+  {
+    Database db;
+    DatabaseStorage storage(path);
+    {
+      LOG_DURATION("replay log");
+      storage.Load(db);
+    }
+    storage.WriteSnapshot(db);
+  }
+  cerr << filesystem::file_size(path + ".snapshot") / (1 << 20) << " MB of snapshot" << endl;
+  {
+    LOG_DURATION("load snapshot");
+    Database db;
+    DatabaseStorage storage(path);
+    storage.Load(db);
+  }
+  for (const char* suffix : {".snapshot", ".log"}) {
+    filesystem::remove(path + suffix);
+  }
+}
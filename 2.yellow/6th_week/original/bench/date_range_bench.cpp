@@ -0,0 +1,34 @@
+#include "benchmarks.h"
+#include "bench_utils.h"
+#include "condition_parser.h"
+#include "database.h"
+#include "profile.h"
+
+#include <iostream>
+#include <sstream>
+using namespace std;
+
+void BenchmarkDateRange() {
+  Database db;
+  // about 30 years of history
+  for (const auto& e : GenerateEntries(4'000'000, 30 * 372, 100'000)) {
+    db.Add(e.date, e.event);
+  }
+
+  istringstream is("date >= 2017-01-01 AND date < 2017-02-01");
+  const auto condition = ParseCondition(is);
+  auto predicate = [&condition](const Date& date, const string& event) {
+    return condition->Evaluate(date, event);
+  };
+
+  size_t full_found, range_found;
+  {
+    LOG_DURATION("one month, full scan");
+    full_found = db.Findif (predicate).size();
+  }
+  {
+    LOG_DURATION("one month, date range");
+    range_found = db.Findif (predicate, condition->GetDateRange()).size();
+  }
+  cerr << "found " << full_found << " and " << range_found << " entries" << endl;
+}
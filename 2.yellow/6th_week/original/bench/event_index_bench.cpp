@@ -0,0 +1,47 @@
+#include "benchmarks.h"
+#include "bench_utils.h"
+#include "database.h"
+#include "profile.h"
+
+#include <chrono>
+#include <iostream>
+using namespace std;
+using namespace std::chrono;
+
+template <typename Query>
+double MeasureMicroseconds(int repeats, Query query) {
+  const auto start = steady_clock::now();
+  for (int i = 0; i < repeats; ++i) {
+    query(i);
+  }
+  return duration_cast<microseconds>(steady_clock::now() - start).count() / static_cast<double>(repeats);
+}
+
+void BenchmarkEventIndex() {
+  const size_t entry_count = 2'000'000;
+  const int repeats = 20;
+  // 10 distinct events match 10% of entries each, 100'000 events match 0.001%
+  for (int event_count : {10, 1'000, 100'000}) {
+    Database db;
+    for (const auto& e : GenerateEntries(entry_count, 3650, event_count)) {
+      db.Add(e.date, e.event);
+    }
+    {
+      LOG_DURATION("build index for " + to_string(event_count) + " events");
+      db.EnableEventIndex();
+    }
+
+    size_t scan_found = 0, index_found = 0;
+    const double scan = MeasureMicroseconds(repeats, [&](int i) {
+      const string event = "some event number " + to_string(i % event_count);
+      scan_found += db.Findif ([&event](const Date&, const string& e) { return e == event; }).size();
+    });
+    const double indexed = MeasureMicroseconds(repeats, [&](int i) {
+      const string event = "some event number " + to_string(i % event_count);
+      index_found += db.Findif ([](const Date&, const string&) { return true; }, {}, &event).size();
+    });
+
+    cerr << "selectivity " << 100.0 / event_count << "%: scan " << scan << " us, index " << indexed
+         << " us per query, found " << scan_found << " and " << index_found << " entries" << endl;
+  }
+}
@@ -0,0 +1,73 @@
+#include "benchmarks.h"
+#include "bench_utils.h"
+#include "database.h"
+#include "output_writer.h"
+#include "profile.h"
+
+#include <fcntl.h>
+#include <iostream>
+#include <unistd.h>
+using namespace std;
+
+// Printing and counting a query that matches every entry:
+// Findif collects the result first, Select walks the database in place,
+// FindViews collects references to the entries
+void BenchmarkFindCursor() {
+  Database db;
+  for (const auto& e : GenerateEntries(4'000'000, 3650, 100'000)) {
+    db.Add(e.date, e.event);
+  }
+  auto alwaysTrue = [](const Date&, const string&) { return true; };
+  const size_t database_bytes = AllocatedBytes();
+  cerr << "database takes " << database_bytes / (1 << 20) << " MB" << endl;
+
+  const int fd = open("/dev/null", O_WRONLY);
+  {
+    ResetPeakAllocatedBytes();
+    LOG_DURATION("print with Findif");
+    OutputWriter out(fd);
+    const auto entries = db.Findif (alwaysTrue);
+    for (const auto& entry : entries) {
+      out << entry << '\n';
+    }
+    out << "Found " << entries.size() << " entries\n";
+  }
+  cerr << "peak memory " << (PeakAllocatedBytes() - database_bytes) / (1 << 20) << " MB above the database" << endl;
+  {
+    ResetPeakAllocatedBytes();
+    LOG_DURATION("print with Select");
+    OutputWriter out(fd);
+    size_t count = 0;
+    for (const auto& entry : db.Select(alwaysTrue)) {
+      out << entry << '\n';
+      ++count;
+    }
+    out << "Found " << count << " entries\n";
+  }
+  cerr << "peak memory " << (PeakAllocatedBytes() - database_bytes) / (1 << 20) << " MB above the database" << endl;
+  {
+    ResetPeakAllocatedBytes();
+    LOG_DURATION("print with FindViews");
+    OutputWriter out(fd);
+    const auto entries = db.FindViews(alwaysTrue);
+    for (const auto& entry : entries) {
+      out << entry << '\n';
+    }
+    out << "Found " << entries.size() << " entries\n";
+  }
+  cerr << "peak memory " << (PeakAllocatedBytes() - database_bytes) / (1 << 20) << " MB above the database" << endl;
+  close(fd);
+
+  size_t found, counted;
+  {
+    LOG_DURATION("count with Findif");
+    found = db.Findif (alwaysTrue).size();
+  }
+  {
+    ResetPeakAllocatedBytes();
+    LOG_DURATION("count with Countif");
+    counted = db.Countif (alwaysTrue);
+  }
+  cerr << "peak memory " << (PeakAllocatedBytes() - database_bytes) / 1024 << " KB above the database, found "
+       << found << " and " << counted << " entries" << endl;
+}
@@ -0,0 +1,91 @@
+#include "benchmarks.h"
+#include "bench_utils.h"
+#include "database.h"
+#include "profile.h"
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+using namespace std;
+
+// 1M random Last queries over 30 years of dates,
+// then changes of dates in random order mixed with Last
+void BenchmarkLast() {
+  Database db;
+  for (const auto& e : GenerateEntries(2'000'000, 30 * 372, 100'000)) {
+    db.Add(e.date, e.event);
+  }
+  const auto& data = db.GetAll();
+  const Date first = data.begin()->first;
+
+  mt19937 gen(1);
+  uniform_int_distribution<int> year(first.year, first.year + 31);
+  uniform_int_distribution<int> month(1, 12);
+  uniform_int_distribution<int> day(1, 31);
+  vector<Date> queries(1'000'000);
+  for (auto& date : queries) {
+    date = {year(gen), month(gen), day(gen)};
+  }
+
+  size_t checksum = 0;
+  {
+    // the way Last worked before the cache
+    LOG_DURATION("upper_bound on the map");
+    for (const Date& date : queries) {
+      auto it = data.upper_bound(date);
+      if (it != data.begin()) {
+        checksum += prev(it)->second.GetAll().back().size();
+      }
+    }
+  }
+  {
+    LOG_DURATION("Last");
+    for (const Date& date : queries) {
+      try {
+        checksum += db.Last(date).event.size();
+      } catch (invalid_argument&) {
+      }
+    }
+  }
+  ResetPeakAllocatedBytes();
+  const size_t allocated = AllocatedBytes();
+  {
+    LOG_DURATION("LastView");
+    for (const Date& date : queries) {
+      try {
+        checksum += db.LastView(date).event.size();
+      } catch (invalid_argument&) {
+      }
+    }
+  }
+  cerr << "LastView allocated " << PeakAllocatedBytes() - allocated << " bytes, checksum " << checksum << endl;
+
+  vector<Date> dates;
+  for (int year = 1; year <= 1000; ++year) {
+    for (int month = 1; month <= 12; ++month) {
+      for (int day = 1; day <= 28; ++day) {
+        dates.push_back({year, month, day});
+      }
+    }
+  }
+  shuffle(dates.begin(), dates.end(), gen);
+  Database shuffled;
+  {
+    LOG_DURATION(to_string(dates.size()) + " dates in random order");
+    for (const Date& date : dates) {
+      shuffled.Add(date, "event");
+      checksum += shuffled.LastView(date).event.size();
+    }
+  }
+  {
+    LOG_DURATION("Del of every other date");
+    shuffled.Removeif ([](const Date& date, const string&) { return date.day % 2 == 0; });
+    for (const Date& date : dates) {
+      try {
+        checksum += shuffled.LastView(date).event.size();
+      } catch (invalid_argument&) {
+      }
+    }
+  }
+  cerr << "checksum " << checksum << endl;
+}
@@ -0,0 +1,16 @@
+// Benchmarks are kept apart from the solution, build them from the parent directory:
+//   g++ -std=c++17 -O2 -pthread -I. -I../../../utils bench/*.cpp $(ls *.cpp | grep -v -e main.cpp -e _test.cpp)
+#include "benchmarks.h"
+
+int main() {
+  BenchmarkColumnarDatabase();
+  BenchmarkCommandReader();
+  BenchmarkDatabaseStorage();
+  BenchmarkDateRange();
+  BenchmarkEventIndex();
+  BenchmarkFindCursor();
+  BenchmarkLast();
+  BenchmarkOutputWriter();
+  BenchmarkParallelScan();
+  return 0;
+}
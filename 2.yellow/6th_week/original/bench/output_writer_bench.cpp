@@ -0,0 +1,56 @@
+#include "benchmarks.h"
+#include "bench_utils.h"
+#include "database.h"
+#include "output_writer.h"
+
+#include <chrono>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+using namespace std;
+using namespace std::chrono;
+
+template <typename Dump>
+void MeasureDump(const string& name, size_t bytes, Dump dump) {
+  const auto start = steady_clock::now();
+  dump();
+  const double seconds = duration<double>(steady_clock::now() - start).count();
+  cerr << name << ": " << bytes / seconds / (1 << 20) << " MB/s" << endl;
+}
+
+// Print of the whole database into /dev/null
+void BenchmarkOutputWriter() {
+  Database db;
+  size_t bytes = 0;
+  for (const auto& e : GenerateEntries(5'000'000, 3650, 100'000)) {
+    db.Add(e.date, e.event);
+  }
+  for (const auto& kv : db.GetAll()) {
+    for (const auto& event : kv.second.GetAll()) {
+      bytes += 12 + event.size();
+    }
+  }
+
+  // the way Print worked before OutputWriter
+  MeasureDump("ostream with endl", bytes, [&db] {
+    ofstream os("/dev/null");
+    for (const auto& kv : db.GetAll()) {
+      for (const auto& event : kv.second.GetAll()) {
+        os << kv.first << ' ' << event << endl;
+      }
+    }
+  });
+  MeasureDump("output writer over ostream", bytes, [&db] {
+    ofstream os("/dev/null");
+    db.Print(os);
+  });
+  MeasureDump("output writer over file descriptor", bytes, [&db] {
+    const int fd = open("/dev/null", O_WRONLY);
+    {
+      OutputWriter out(fd);
+      db.Print(out);
+    }
+    close(fd);
+  });
+}
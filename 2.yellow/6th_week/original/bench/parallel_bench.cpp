@@ -0,0 +1,40 @@
+#include "benchmarks.h"
+#include "bench_utils.h"
+#include "condition_parser.h"
+#include "database.h"
+#include "profile.h"
+
+#include <iostream>
+#include <sstream>
+#include <thread>
+using namespace std;
+
+void BenchmarkParallelScan() {
+  const auto entries = GenerateEntries(4'000'000, 3650, 100'000);
+  istringstream is(R"(event > "some event number 5" AND date > 2003-01-01)");
+  const auto condition = ParseCondition(is);
+  auto predicate = [&condition](const Date& date, const string& event) {
+    return condition->Evaluate(date, event);
+  };
+
+  cerr << thread::hardware_concurrency() << " hardware threads" << endl;
+  for (size_t threads : {1, 2, 4, 8, 16, 32}) {
+    Database db;
+    for (const auto& e : entries) {
+      db.Add(e.date, e.event);
+    }
+    db.SetThreadCount(threads);
+
+    size_t found;
+    int removed;
+    {
+      LOG_DURATION(to_string(threads) + " threads find");
+      found = db.Findif (predicate).size();
+    }
+    {
+      LOG_DURATION(to_string(threads) + " threads remove");
+      removed = db.Removeif (predicate);
+    }
+    cerr << "  found " << found << ", removed " << removed << endl;
+  }
+}
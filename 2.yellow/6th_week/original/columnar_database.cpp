@@ -0,0 +1,76 @@
+#include "columnar_database.h"
+#include <stdexcept>
+using namespace std;
+
+uint32_t EventArena::Intern(const string& event) {
+  if (auto it = offsets_.find(event); it != offsets_.end()) {
+    return it->second;
+  }
+  const auto offset = static_cast<uint32_t>(events_.size());
+  // deque never moves its elements, so the view stays valid
+  offsets_.emplace(events_.emplace_back(event), offset);
+  return offset;
+}
+
+void ColumnarDatabase::Partition::Add(uint32_t offset) {
+  if (present_.insert(offset).second) {
+    order_.push_back(offset);
+  }
+}
+
+void ColumnarDatabase::Add(const Date& date, const string& event) {
+  if (!FitsKey(date)) {
+    throw invalid_argument("Date doesn't fit into a key");
+  }
+  const int key = DateToKey(date);
+  const auto [it, new_date] = positions_.emplace(key, static_cast<uint32_t>(keys_.size()));
+  if (new_date) {
+    keys_.push_back(key);
+    partitions_.emplace_back();
+  }
+  partitions_[it->second].Add(arena_.Intern(event));
+}
+
+const vector<uint32_t>& ColumnarDatabase::GetSorted() const {
+  const size_t sorted_count = sorted_.size();
+  if (sorted_count == keys_.size()) {
+    return sorted_;
+  }
+  for (size_t i = sorted_count; i < keys_.size(); ++i) {
+    sorted_.push_back(i);
+  }
+  const auto by_key = [this](uint32_t lhs, uint32_t rhs) {
+    return keys_[lhs] < keys_[rhs];
+  };
+  // dates added since the last read are sorted apart and merged into the rest
+  sort(sorted_.begin() + sorted_count, sorted_.end(), by_key);
+  inplace_merge(sorted_.begin(), sorted_.begin() + sorted_count, sorted_.end(), by_key);
+  return sorted_;
+}
+
+void ColumnarDatabase::Print(ostream& os) const {
+  OutputWriter out(os);
+  for (uint32_t i : GetSorted()) {
+    const Date date = KeyToDate(keys_[i]);
+    for (uint32_t offset : partitions_[i].GetAll()) {
+      out << date << ' ' << arena_.Get(offset) << '\n';
+    }
+  }
+}
+
+Entry ColumnarDatabase::Last(const Date& date) const {
+  const auto& sorted = GetSorted();
+  // a date that doesn't fit into a key is compared with the dates of the keys
+  auto it = FitsKey(date)
+      ? upper_bound(sorted.begin(), sorted.end(), DateToKey(date), [this](int key, uint32_t i) {
+          return key < keys_[i];
+        })
+      : upper_bound(sorted.begin(), sorted.end(), date, [this](const Date& lhs, uint32_t i) {
+          return lhs < KeyToDate(keys_[i]);
+        });
+  if (it == sorted.begin()) {
+    throw invalid_argument("");
+  }
+  --it;
+  return {KeyToDate(keys_[*it]), arena_.Get(partitions_[*it].GetAll().back())};
+}
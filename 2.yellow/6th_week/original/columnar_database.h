@@ -0,0 +1,152 @@
+#pragma once
+
+#include "database.h"
+#include "date.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+// Stores every distinct event string exactly once and hands out
+// its offset in the arena instead of the string itself.
+// Interned strings are never released, so offsets stay valid forever.
+class EventArena {
+ public:
+  uint32_t Intern(const string& event);
+
+  const string& Get(uint32_t offset) const {
+    return events_[offset];
+  }
+
+  size_t Size() const {
+    return events_.size();
+  }
+
+ private:
+  deque<string> events_;
+  unordered_map<string_view, uint32_t> offsets_;
+};
+
+
+// Same interface as Database, but dates are packed into an array of integer
+// keys and every date keeps only offsets of its events in the arena.
+// New dates are appended and found by a hash map, the order of keys is
+// restored only when the dates are read, so adding them in any order takes
+// O(1) per entry, and a read after k new dates takes O(k log k + dates).
+class ColumnarDatabase {
+ public:
+  // throws invalid_argument if the date doesn't fit into a key
+  void Add(const Date& date, const string& event);
+
+  template <typename Predicate>
+  int Removeif (Predicate predicate) {
+    int result = 0;
+    for (uint32_t i : GetSorted()) {
+      const Date date = KeyToDate(keys_[i]);
+      result += partitions_[i].Removeif ([&](uint32_t offset) {
+        return predicate(date, arena_.Get(offset));
+      });
+    }
+
+    // the dates left are put in order, so they need no sorting
+    vector<int> keys;
+    vector<Partition> partitions;
+    for (uint32_t i : sorted_) {
+      if (!partitions_[i].Empty()) {
+        keys.push_back(keys_[i]);
+        partitions.push_back(move(partitions_[i]));
+      }
+    }
+    keys_ = move(keys);
+    partitions_ = move(partitions);
+    positions_.clear();
+    sorted_.resize(keys_.size());
+    for (size_t i = 0; i < keys_.size(); ++i) {
+      positions_.emplace(keys_[i], i);
+      sorted_[i] = i;
+    }
+    return result;
+  }
+
+  template <typename Predicate>
+  vector<Entry> Findif (Predicate predicate) const {
+    vector<Entry> result;
+    for (uint32_t i : GetSorted()) {
+      const Date date = KeyToDate(keys_[i]);
+      for (uint32_t offset : partitions_[i].GetAll()) {
+        const string& event = arena_.Get(offset);
+        if (predicate(date, event)) {
+          result.push_back(Entry{date, event});
+        }
+      }
+    }
+    return result;
+  }
+
+  void Print(ostream& os) const;
+
+  // throws invalid_argument if there is no last event for the given date
+  Entry Last(const Date& date) const;
+
+ private:
+  // Events of a single date: offsets in order of addition
+  // and the same offsets in a hash set to detect duplicates
+  class Partition {
+   public:
+    void Add(uint32_t offset);
+
+    const vector<uint32_t>& GetAll() const {
+      return order_;
+    }
+
+    bool Empty() const {
+      return order_.empty();
+    }
+
+    template <typename Predicate>
+    int Removeif (Predicate predicate) {
+      auto split_point = stable_partition(order_.begin(), order_.end(),
+                                          [&](uint32_t offset) { return !predicate(offset); });
+      const int result = order_.end() - split_point;
+      if (result > 0) {
+        for (auto it = split_point; it != order_.end(); ++it) {
+          present_.erase(*it);
+        }
+        order_.erase(split_point, order_.end());
+      }
+      return result;
+    }
+
+   private:
+    vector<uint32_t> order_;
+    unordered_set<uint32_t> present_;
+  };
+
+
+  // Positions of keys_ in the order of keys
+  const vector<uint32_t>& GetSorted() const;
+
+  EventArena arena_;
+  // dates in order of addition and their events
+  vector<int> keys_;
+  vector<Partition> partitions_;
+  // position of every key in keys_
+  unordered_map<int, uint32_t> positions_;
+  // positions in the order of keys, the ones added after the last read aren't there
+  mutable vector<uint32_t> sorted_;
+};
+
+
+// Tests
+void TestColumnarDatabaseAddAndPrint();
+void TestColumnarDatabaseFind();
+void TestColumnarDatabaseRemove();
+void TestColumnarDatabaseLast();
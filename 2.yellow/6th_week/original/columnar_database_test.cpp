@@ -0,0 +1,185 @@
+#include "columnar_database.h"
+#include "test_runner.h"
+
+#include <string>
+#include <sstream>
+#include <vector>
+using namespace std;
+
+void TestColumnarDatabaseAddAndPrint() { {
+    ColumnarDatabase db;
+    db.Add({2017, 3, 1}, "1st of March");
+    db.Add({2017, 2, 1}, "1st of February");
+    db.Add({2017, 1, 1}, "1st of January");
+
+    ostringstream os;
+    db.Print(os);
+
+    const string expected = "2017-01-01 1st of January\n"
+        "2017-02-01 1st of February\n"
+        "2017-03-01 1st of March\n";
+    AssertEqual(os.str(), expected, "Columnar print: events should sorted by date");
+  } {
+    ColumnarDatabase db;
+    db.Add({2017, 3, 1}, "01.03 1");
+    db.Add({2017, 3, 5}, "05.03 1");
+    db.Add({2017, 3, 1}, "01.03 2");
+    db.Add({2017, 3, 1}, "01.03 1");
+    db.Add({2017, 3, 5}, "01.03 1");
+
+    ostringstream os;
+    db.Print(os);
+
+    const string expected = "2017-03-01 01.03 1\n"
+        "2017-03-01 01.03 2\n"
+        "2017-03-05 05.03 1\n"
+        "2017-03-05 01.03 1\n";
+    AssertEqual(os.str(), expected, "Columnar print: duplicates are ignored only within a date");
+  } {
+    ColumnarDatabase db;
+    db.Add({2, 10, 10}, "year less than 1000");
+    db.Add({9999, 12, 31}, "the last day");
+
+    ostringstream os;
+    db.Print(os);
+
+    const string expected = "0002-10-10 year less than 1000\n"
+        "9999-12-31 the last day\n";
+    AssertEqual(os.str(), expected, "Columnar print: date keys keep year, month and day");
+  }
+}
+
+void TestColumnarDatabaseFind() { {
+    ColumnarDatabase db;
+    db.Add({2017, 11, 17}, "Friday");
+    db.Add({2016, 11, 17}, "Thursday");
+    db.Add({2015, 11, 17}, "Tuesday");
+    db.Add({2014, 11, 17}, "Monday");
+
+    auto complexCondition = [](const Date& date, const string& event) {
+      return date.year == 2016 || event == "Monday";
+    };
+
+    const vector<Entry> expected = {{{2014, 11, 17}, "Monday"}, {{2016, 11, 17}, "Thursday"}};
+
+    AssertEqual(db.Findif (complexCondition), expected, "Columnar find: complex condition");
+  } {
+    ColumnarDatabase db;
+    db.Add({2017, 11, 17}, "Friday");
+
+    auto acceptsNothing = [](const Date&, const string&) { return false; };
+
+    AssertEqual(db.Findif (acceptsNothing), vector<Entry>(), "Columnar find: accepts nothing");
+  }
+}
+
+void TestColumnarDatabaseRemove() { {
+    ColumnarDatabase db;
+    db.Add({2017, 11, 17}, "Friday");
+    db.Add({2016, 11, 17}, "Thursday");
+    db.Add({2015, 11, 17}, "Tuesday");
+    db.Add({2014, 11, 17}, "Monday");
+
+    auto alwaysTrue = [](const Date&, const string&) { return true; };
+
+    AssertEqual(db.Removeif (alwaysTrue), 4, "Columnar remove: alwaysTrue removes all 1");
+    AssertEqual(db.Findif (alwaysTrue), vector<Entry>(), "Columnar remove: alwaysTrue removes all 2");
+  } {
+    const Date date = {2017, 11, 24};
+
+    ColumnarDatabase db;
+    db.Add(date, "abc");
+    db.Add(date, "bca");
+    db.Add(date, "abd");
+    db.Add(date, "cba");
+
+    AssertEqual(db.Removeif ([](const Date&, const string& event) { return event[0] == 'a'; }), 2,
+                "Columnar remove: removed count");
+
+    ostringstream os;
+    db.Print(os);
+    const string expected =
+        "2017-11-24 bca\n"
+        "2017-11-24 cba\n";
+    AssertEqual(os.str(), expected, "Columnar remove: entries should be printed in order of addition");
+
+    db.Add(date, "abc");
+    os.str("");
+    db.Print(os);
+    AssertEqual(os.str(), expected + "2017-11-24 abc\n", "Columnar remove: removed event can be added again");
+  } {
+    // dates added between reads and after a removal are merged into the order
+    ColumnarDatabase db;
+    for (int day = 28; day >= 1; day -= 3) {
+      db.Add({2017, 1, day}, "event");
+    }
+    AssertEqual(db.Last({2017, 1, 5}), Entry{{2017, 1, 4}, "event"}, "Columnar remove: last before adding");
+    for (int day = 27; day >= 1; day -= 3) {
+      db.Add({2017, 1, day}, "event");
+    }
+    AssertEqual(db.Removeif ([](const Date& date, const string&) { return date.day % 2 == 0; }), 9,
+                "Columnar remove: every other date");
+    db.Add({2017, 1, 2}, "again");
+    db.Add({2017, 1, 3}, "more");
+    db.Add({2016, 12, 31}, "first");
+
+    vector<Entry> expected = {{{2016, 12, 31}, "first"}, {{2017, 1, 1}, "event"}, {{2017, 1, 2}, "again"},
+                              {{2017, 1, 3}, "event"}, {{2017, 1, 3}, "more"}};
+    // odd days left of 28, 25, ..., 1 and 27, 24, ..., 3
+    for (int day : {7, 9, 13, 15, 19, 21, 25, 27}) {
+      expected.push_back({{2017, 1, day}, "event"});
+    }
+    AssertEqual(db.Findif ([](const Date&, const string&) { return true; }), expected,
+                "Columnar remove: order after adding dates in reverse");
+  }
+}
+
+void TestColumnarDatabaseLast() { {
+    ColumnarDatabase db;
+    db.Add({2017, 11, 17}, "Friday");
+    db.Add({2017, 11, 17}, "One more event");
+    db.Add({2016, 11, 17}, "Thursday");
+
+    AssertEqual(db.Last({2017, 11, 17}), Entry{{2017, 11, 17}, "One more event"}, "Columnar last: successful 1");
+    AssertEqual(db.Last({2017, 11, 16}), Entry{{2016, 11, 17}, "Thursday"}, "Columnar last: successful 2");
+    AssertEqual(db.Last({2016, 11, 17}), Entry{{2016, 11, 17}, "Thursday"}, "Columnar last: successful 3");
+
+    bool wasException = false;
+    try {
+      db.Last({1, 1, 1});
+    } catch (invalid_argument&) {
+      wasException = true;
+    }
+    Assert(wasException, "Columnar last: invalid argument wasn't thrown");
+  } {
+    ColumnarDatabase db;
+    db.Add({2017, 11, 17}, "One more event");
+    db.Add({2017, 11, 17}, "Friday");
+    db.Add({2016, 11, 17}, "Thursday");
+    db.Removeif ([](const Date& date, const string&) { return date == Date{2017, 11, 17}; });
+    AssertEqual(db.Last({2017, 11, 17}), Entry{{2016, 11, 17}, "Thursday"}, "Columnar last and remove");
+  } {
+    ColumnarDatabase db;
+    db.Add({2017, 11, 17}, "Friday");
+    for (const Date& date : {Date{2017, 16, 1}, Date{2017, 1, 32}, Date{-1, 1, 1}}) {
+      bool wasException = false;
+      try {
+        db.Add(date, "out of range");
+      } catch (invalid_argument&) {
+        wasException = true;
+      }
+      Assert(wasException, "Columnar add: dates that don't fit into a key are rejected");
+    }
+    AssertEqual(db.Last({2017, 12, 0}), Entry{{2017, 11, 17}, "Friday"}, "Columnar last: day 0");
+    AssertEqual(db.Last({2017, 11, 40}), Entry{{2017, 11, 17}, "Friday"}, "Columnar last: day out of range");
+    AssertEqual(db.Last({2018, -5, 1}), Entry{{2017, 11, 17}, "Friday"}, "Columnar last: negative month");
+    AssertEqual(db.Last({1'000'000'000, 1, 1}), Entry{{2017, 11, 17}, "Friday"}, "Columnar last: huge year");
+    bool wasException = false;
+    try {
+      db.Last({2017, 11, -1});
+    } catch (invalid_argument&) {
+      wasException = true;
+    }
+    Assert(wasException, "Columnar last: nothing before a negative day");
+  }
+}
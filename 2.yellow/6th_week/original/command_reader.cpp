@@ -0,0 +1,74 @@
+#include "command_reader.h"
+
+#include <algorithm>
+#include <cstring>
+using namespace std;
+
+CommandReader::CommandReader(istream& input, size_t block_size)
+  : input_(input)
+  , block_size_(max<size_t>(1, block_size))
+  , buffer_(block_size_) {
+}
+
+bool CommandReader::ReadLine(string_view& line) {
+  size_t searched = begin_;
+  while (true) {
+    const char* const data = buffer_.data();
+    const void* newline = memchr(data + searched, '\n', end_ - searched);
+    if (newline) {
+      const size_t position = static_cast<const char*>(newline) - data;
+      line = {data + begin_, position - begin_};
+      begin_ = position + 1;
+      return true;
+    }
+    // the line continues in the next block
+    searched = end_ - begin_;
+    if (!ReadBlock()) {
+      break;
+    }
+  }
+  if (begin_ == end_) {
+    return false;
+  }
+  // the last line isn't followed by '\n'
+  line = {buffer_.data() + begin_, end_ - begin_};
+  begin_ = end_;
+  return true;
+}
+
+bool CommandReader::ReadBlock() {
+  if (!input_) {
+    return false;
+  }
+  const size_t unread = end_ - begin_;
+  memmove(buffer_.data(), buffer_.data() + begin_, unread);
+  begin_ = 0;
+  end_ = unread;
+  if (buffer_.size() < unread + block_size_) {
+    buffer_.resize(max(unread + block_size_, 2 * buffer_.size()));
+  }
+  input_.read(buffer_.data() + end_, block_size_);
+  end_ += input_.gcount();
+  return input_.gcount() > 0;
+}
+
+string_view ReadWord(string_view& line) {
+  size_t begin = 0;
+  while (begin < line.size() && isspace(static_cast<unsigned char>(line[begin]))) {
+    ++begin;
+  }
+  size_t end = begin;
+  while (end < line.size() && !isspace(static_cast<unsigned char>(line[end]))) {
+    ++end;
+  }
+  const string_view word = line.substr(begin, end - begin);
+  line.remove_prefix(end);
+  return word;
+}
+
+string_view ParseEvent(string_view line) {
+  while (!line.empty() && isspace(static_cast<unsigned char>(line.front()))) {
+    line.remove_prefix(1);
+  }
+  return line;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// Reads the input by large blocks and hands out its lines as views
+// into the buffer, so that no strings or streams are made per line
+class CommandReader {
+ public:
+  explicit CommandReader(istream& input, size_t block_size = 1 << 20);
+
+  // The line is valid until the next call. Returns false at the end of input
+  bool ReadLine(string_view& line);
+
+ private:
+  // Moves the unread part to the front and reads the next block after it.
+  // Returns false if nothing was read
+  bool ReadBlock();
+
+  istream& input_;
+  size_t block_size_;
+  vector<char> buffer_;
+  size_t begin_ = 0;
+  size_t end_ = 0;
+};
+
+// Removes the first word from the line the way operator >> reads it
+string_view ReadWord(string_view& line);
+// The rest of the line without leading spaces
+string_view ParseEvent(string_view line);
+
+// Tests
+void TestCommandReader();
+void TestReadWord();
@@ -0,0 +1,66 @@
+#include "command_reader.h"
+#include "test_runner.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+vector<string> ReadAllLines(const string& input, size_t block_size) {
+  istringstream is(input);
+  CommandReader reader(is, block_size);
+  vector<string> result;
+  for (string_view line; reader.ReadLine(line); ) {
+    result.emplace_back(line);
+  }
+  return result;
+}
+
+void TestCommandReader() {
+  const vector<string> inputs = {
+    "",
+    "\n",
+    "Print",
+    "Print\n",
+    "Add 2017-01-01 Holiday\n\nAdd 2017-03-08 Holiday\nFind event != \"working day\"\n",
+    "Last 2017-11-20\nDel date > 2017-01-01 AND date < 2017-06-01",
+    "  leading spaces\n\n\ntrailing spaces   \n",
+  };
+  for (const string& input : inputs) {
+    vector<string> expected;
+    istringstream is(input);
+    for (string line; getline(is, line); ) {
+      expected.push_back(line);
+    }
+    // small blocks make lines cross block boundaries
+    for (size_t block_size : {1, 2, 3, 7, 1 << 20}) {
+      AssertEqual(ReadAllLines(input, block_size), expected,
+                  "Command reader: block size " + to_string(block_size) + ", input " + input);
+    }
+  }
+  {
+    const string long_line(1000, 'a');
+    AssertEqual(ReadAllLines(long_line + "\nb", 16), vector<string>{long_line, "b"},
+                "Command reader: line longer than a block");
+  }
+}
+
+void TestReadWord() { {
+    string_view line = "  Add 2017-01-01   sport event ";
+    AssertEqual(string(ReadWord(line)), "Add", "Read word: command");
+    AssertEqual(string(ReadWord(line)), "2017-01-01", "Read word: date");
+    AssertEqual(string(ParseEvent(line)), "sport event ", "Read word: event is the rest of the line");
+  } {
+    string_view line = "Print";
+    AssertEqual(string(ReadWord(line)), "Print", "Read word: the whole line");
+    AssertEqual(string(ReadWord(line)), "", "Read word: end of line");
+  } {
+    string_view line = "   ";
+    AssertEqual(string(ReadWord(line)), "", "Read word: only spaces");
+    AssertEqual(string(ParseEvent("event")), "event", "Parse event view without leading spaces");
+  } {
+    string_view line = " \xd0\xb4\xd0\xb5\xd0\xbd\xd1\x8c \xff";
+    AssertEqual(string(ReadWord(line)), "\xd0\xb4\xd0\xb5\xd0\xbd\xd1\x8c", "Read word: bytes above 127");
+    AssertEqual(string(ParseEvent(line)), "\xff", "Parse event: bytes above 127");
+  }
+}
@@ -9,7 +9,7 @@ template <class It> shared_ptr<Node> ParseComparison(It& current, It end) {
     throw logic_error("Expected column name: date or event");
   }
 
-  Token& column = *current;
+  const auto& column = *current;
   if (column.type != TokenType::COLUMN) {
     throw logic_error("Expected column name: date or event");
   }
@@ -19,7 +19,7 @@ template <class It> shared_ptr<Node> ParseComparison(It& current, It end) {
     throw logic_error("Expected comparison operation");
   }
 
-  Token& op = *current;
+  const auto& op = *current;
   if (op.type != TokenType::COMPARE_OP) {
     throw logic_error("Expected comparison operation");
   }
@@ -43,17 +43,16 @@ template <class It> shared_ptr<Node> ParseComparison(It& current, It end) {
   } else if (op.value == "!=") {
     cmp = Comparison::NotEqual;
   } else {
-    throw logic_error("Unknown comparison token: " + op.value);
+    throw logic_error("Unknown comparison token: " + string(op.value));
   }
 
-  const string& value = current->value;
+  string_view value = current->value;
   ++current;
 
   if (column.value == "date") {
-    istringstream is(value);
-    return make_shared<DateComparisonNode>(cmp, ParseDate(is));
+    return make_shared<DateComparisonNode>(cmp, ParseDate(value));
   } else {
-    return make_shared<EventComparisonNode>(cmp, value);
+    return make_shared<EventComparisonNode>(cmp, string(value));
   }
 }
 
@@ -103,8 +102,8 @@ shared_ptr<Node> ParseExpression(It& current, It end, unsigned precedence) {
   return left;
 }
 
-shared_ptr<Node> ParseCondition(istream& is) {
-  auto tokens = Tokenize(is);
+template <class Tokens>
+shared_ptr<Node> ParseTokens(Tokens& tokens) {
   auto current = tokens.begin();
   auto top_node = ParseExpression(current, tokens.end(), 0u);
 
@@ -118,3 +117,13 @@ shared_ptr<Node> ParseCondition(istream& is) {
 
   return top_node;
 }
+
+shared_ptr<Node> ParseCondition(istream& is) {
+  auto tokens = Tokenize(is);
+  return ParseTokens(tokens);
+}
+
+shared_ptr<Node> ParseCondition(string_view line) {
+  auto tokens = Tokenize(line);
+  return ParseTokens(tokens);
+}
@@ -4,9 +4,14 @@
 
 #include <memory>
 #include <iostream>
+#include <string_view>
 
 using namespace std;
 
 shared_ptr<Node> ParseCondition(istream& is);
+// Parses the condition straight from the line, without streams
+shared_ptr<Node> ParseCondition(string_view line);
 
 void TestParseCondition();
+void TestParseConditionDateRange();
+void TestParseConditionFromLine();
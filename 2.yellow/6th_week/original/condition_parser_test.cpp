@@ -2,6 +2,7 @@
 #include "test_runner.h"
 
 #include <sstream>
+#include <vector>
 using namespace std;
 
 void TestParseCondition() { {
@@ -66,3 +67,59 @@ void TestParseCondition() { {
     Assert(root->Evaluate({2016, 1, 2}, "event"), "Parse condition 30");
   }
 }
+
+void TestParseConditionDateRange() { {
+    istringstream is("date >= 2017-01-01 AND date < 2017-02-01");
+    const DateRange range = ParseCondition(is)->GetDateRange();
+    AssertEqual(range.first, Date{2017, 1, 1}, "Parse date range 1");
+    // there are no dates between 2017-01-31 and 2017-02-00 in the order of tuples
+    AssertEqual(range.last, Date{2017, 2, 0}, "Parse date range 2");
+  } {
+    istringstream is(R"(date > 2017-01-01 AND (event == "holiday" OR date < 2017-07-01))");
+    const DateRange range = ParseCondition(is)->GetDateRange();
+    AssertEqual(range.first, Date{2017, 1, 2}, "Parse date range 3");
+    Assert(Date{9999, 12, 31} < range.last, "Parse date range 4");
+  } {
+    istringstream is("(date == 2017-01-01 OR date == 2017-03-08) AND date > 2017-02-01");
+    const DateRange range = ParseCondition(is)->GetDateRange();
+    AssertEqual(range.first, Date{2017, 2, 2}, "Parse date range 5");
+    AssertEqual(range.last, Date{2017, 3, 8}, "Parse date range 6");
+  } {
+    istringstream is("date < 2017-01-01 AND date > 2017-02-01");
+    Assert(ParseCondition(is)->GetDateRange().IsEmpty(), "Parse date range 7");
+  }
+}
+
+void TestParseConditionFromLine() {
+  const vector<string> conditions = {
+    "",
+    "date != 2017-11-18",
+    R"(event == "sport event")",
+    R"(event != "")",
+    "date >= 2017-1-1 AND date < 2017-07-01",
+    R"(date > 2017-01-01 AND (event == "holiday" OR date < 2017-07-01))",
+    R"(((event == "2017-01-01" OR date > 2016-01-01)))",
+  };
+  const vector<Date> dates = {{1, 1, 1}, {2016, 1, 1}, {2017, 1, 1}, {2017, 1, 2}, {2017, 11, 18}, {2018, 1, 1}};
+  const vector<string> events = {"", "holiday", "sport event", "2017-01-01"};
+
+  for (const string& condition : conditions) {
+    istringstream is(condition);
+    const shared_ptr<Node> from_stream = ParseCondition(is);
+    const shared_ptr<Node> from_line = ParseCondition(string_view(condition));
+    for (const Date& date : dates) {
+      for (const string& event : events) {
+        AssertEqual(from_line->Evaluate(date, event), from_stream->Evaluate(date, event),
+                    "Parse condition from line: " + condition);
+      }
+    }
+  }
+
+  bool wasException = false;
+  try {
+    ParseCondition(string_view("date == "));
+  } catch (logic_error&) {
+    wasException = true;
+  }
+  Assert(wasException, "Parse condition from line: incomplete condition");
+}
@@ -4,32 +4,178 @@
 #include <tuple>
 using namespace std;
 
-void Database::Add(const Date& date, const string& event) {
-  data_[date].Add(event);
+namespace {
+
+// Number of keys not greater than key. The loop has a fixed number
+// of steps for the size and compiles into conditional moves
+size_t CountNotGreater(const vector<int>& keys, int key) {
+  if (keys.empty()) {
+    return 0;
+  }
+  const int* base = keys.data();
+  for (size_t size = keys.size(); size > 1; ) {
+    const size_t half = size / 2;
+    base = base[half] <= key ? base + half : base;
+    size -= half;
+  }
+  return (base - keys.data()) + (*base <= key);
+}
+
+}
+
+bool Database::Add(const Date& date, const string& event) {
+  auto [it, new_date] = data_.try_emplace(date);
+  if (!it->second.Add(event)) {
+    return false;
+  }
+  if (has_event_index_) {
+    event_index_[event].insert(date);
+  }
+
+  if (last_stale_) {
+    return true;
+  }
+  if (!FitsKey(date)) {
+    unkeyed_dates_ += new_date;
+    return true;
+  }
+  const int key = DateToKey(date);
+  const LastEntry last{&it->first, &it->second.GetAll().back()};
+  // dates are mostly added in order
+  if (last_keys_.empty() || last_keys_.back() < key) {
+    last_keys_.push_back(key);
+    last_entries_.push_back(last);
+  } else if (!new_date) {
+    // the vector of events may have moved
+    const size_t position = lower_bound(last_keys_.begin(), last_keys_.end(), key) - last_keys_.begin();
+    last_entries_[position] = last;
+  } else {
+    // inserting into the middle of the cache would move the dates after it
+    last_stale_ = true;
+  }
+  return true;
+}
+
+void Database::AddDate(const Date& date, EventSet events) {
+  if (events.GetAll().empty()) {
+    return;
+  }
+  const auto hint = data_.lower_bound(date);
+  if (hint != data_.end() && hint->first == date) {
+    throw invalid_argument("Date is already in the database");
+  }
+  const auto it = data_.emplace_hint(hint, date, move(events));
+  if (has_event_index_) {
+    for (const auto& event : it->second.GetAll()) {
+      event_index_[event].insert(date);
+    }
+  }
+  last_stale_ = true;
+}
+
+void Database::EraseIfEmpty(map<Date, EventSet>::iterator it) {
+  last_stale_ = true;
+  if (it->second.GetAll().empty()) {
+    data_.erase(it);
+  }
+}
+
+void Database::RebuildLastCache() const {
+  last_keys_.clear();
+  last_entries_.clear();
+  unkeyed_dates_ = 0;
+  for (const auto& [date, events] : data_) {
+    if (!FitsKey(date)) {
+      ++unkeyed_dates_;
+      continue;
+    }
+    last_keys_.push_back(DateToKey(date));
+    last_entries_.push_back({&date, &events.GetAll().back()});
+  }
+  last_stale_ = false;
+  stale_queries_ = 0;
+}
+
+void Database::SetThreadCount(size_t thread_count) {
+  thread_count_ = max<size_t>(1, thread_count);
+}
+
+void Database::EnableEventIndex() {
+  if (has_event_index_) {
+    return;
+  }
+  has_event_index_ = true;
+  for (const auto& kv : data_) {
+    for (const auto& event : kv.second.GetAll()) {
+      event_index_[event].insert(kv.first);
+    }
+  }
+}
+
+void Database::RemoveFromIndex(const Date& date, const string& event) {
+  auto posting = event_index_.find(event);
+  posting->second.erase(date);
+  if (posting->second.empty()) {
+    event_index_.erase(posting);
+  }
 }
 
 void Database::Print(ostream& os) const {
+  OutputWriter out(os);
+  Print(out);
+}
+
+void Database::Print(OutputWriter& out) const {
   for (const auto& kv : data_) {
     for (const auto& event : kv.second.GetAll()) {
-      os << kv.first << ' ' << event << endl;
+      out << kv.first << ' ' << event << '\n';
     }
   }
 }
 
 Entry Database::Last(const Date& date) const {
+  const EntryView last = LastView(date);
+  return {last.date, last.event};
+}
+
+EntryView Database::LastView(const Date& date) const {
+  // a search in the map costs about as much as copying a few dates
+  if (last_stale_ && ++stale_queries_ >= data_.size() / 8) {
+    RebuildLastCache();
+  }
+  if (!last_stale_ && unkeyed_dates_ == 0 && FitsKey(date)) {
+    const size_t count = CountNotGreater(last_keys_, DateToKey(date));
+    if (count == 0) {
+      throw invalid_argument("");
+    }
+    const LastEntry& last = last_entries_[count - 1];
+    return {*last.date, *last.event};
+  }
+
   auto it = data_.upper_bound(date);
   if (it == data_.begin()) {
     throw invalid_argument("");
   }
   --it;
   return {it->first, it->second.GetAll().back()};
-
 }
 
 ostream& operator << (ostream& os, const Entry& e) {
   return os << e.date << " " << e.event;
 }
 
+OutputWriter& operator << (OutputWriter& out, const Entry& e) {
+  return out << e.date << ' ' << e.event;
+}
+
+ostream& operator << (ostream& os, const EntryView& e) {
+  return os << e.date << " " << e.event;
+}
+
+OutputWriter& operator << (OutputWriter& out, const EntryView& e) {
+  return out << e.date << ' ' << e.event;
+}
+
 bool operator == (const Entry& lhs, const Entry& rhs) {
   return tie(lhs.date, lhs.event) == tie(rhs.date, rhs.event);
 }
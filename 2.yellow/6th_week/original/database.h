@@ -2,9 +2,16 @@
 
 #include "date.h"
 #include "event_set.h"
+#include "find_cursor.h"
+#include "output_writer.h"
 
+#include <algorithm>
+#include <future>
 #include <iostream>
+#include <iterator>
 #include <map>
+#include <set>
+#include <string>
 #include <vector>
 
 using namespace std;
@@ -16,51 +23,375 @@ struct Entry {
 
 
 ostream& operator << (ostream& os, const Entry& e);
+OutputWriter& operator << (OutputWriter& out, const Entry& e);
 bool operator == (const Entry& lhs, const Entry& rhs);
 
 class Database {
  public:
-  void Add(const Date& date, const string& event);
+  Database() = default;
+  // the cache of Last points into data_, so it can't be copied
+  Database(const Database&) = delete;
+  Database& operator = (const Database&) = delete;
+  Database(Database&&) = default;
+  Database& operator = (Database&&) = default;
 
+  // Returns false if the date already has the event
+  bool Add(const Date& date, const string& event);
+  // Adds a date that isn't in the database with all its events at once,
+  // which loads many events faster than Add.
+  // throws invalid_argument if the date is already there
+  void AddDate(const Date& date, EventSet events);
+
+  // Builds an index from events to their dates and keeps it up to date
+  // afterwards, so that queries for a single event don't scan all entries.
+  // The index keeps its own copy of every distinct event, so it is off by default
+  void EnableEventIndex();
+
+  bool HasEventIndex() const {
+    return has_event_index_;
+  }
+
+  // Find and Remove split the scanned dates between this many threads.
+  // The predicate must then be safe to call concurrently
+  void SetThreadCount(size_t thread_count);
+
+  size_t GetThreadCount() const {
+    return thread_count_;
+  }
+
+  // Only dates from the range are checked against the predicate.
+  // If event is given, only entries with this event are checked,
+  // which is done through the event index when it is enabled.
+  // Removed entries are appended to removed unless it is nullptr
   template <typename Predicate>
-  int Removeif (Predicate predicate) {
+  int Removeif (Predicate predicate, const DateRange& range = {}, const string* event = nullptr,
+                vector<Entry>* removed = nullptr) {
+    if (range.IsEmpty()) {
+      return 0;
+    }
+    if (event && has_event_index_) {
+      return RemoveIndexed(predicate, range, *event, removed);
+    }
+    const auto first = data_.lower_bound(range.first);
+    const auto last = data_.upper_bound(range.last);
+    const auto parts = SplitRange(first, last);
+
+    // removed entries are dropped from the index afterwards,
+    // so that threads don't have to share it
+    vector<vector<Entry>> removed_parts(parts.size());
+    auto removed_part = [&](size_t i) {
+      return has_event_index_ || removed ? &removed_parts[i] : nullptr;
+    };
+    vector<future<int>> futures;
+    for (size_t i = 1; i < parts.size(); ++i) {
+      futures.push_back(async(launch::async, [=] {
+        return RemoveInRange(parts[i].first, parts[i].second, predicate, event, removed_part(i));
+      }));
+    }
     int result = 0;
-    for (auto& kv : data_) {
-      const Date& date = kv.first;
-      result += kv.second.Removeif ([=](const string& event) {
-        return predicate(date, event);
-      });
-    }
-    for (auto it = data_.begin(); it != data_.end(); ) {
-      if (it->second.GetAll().empty()) {
-        data_.erase(it++);
-      } else {
-        ++it;
+    if (!parts.empty()) {
+      result = RemoveInRange(parts[0].first, parts[0].second, predicate, event, removed_part(0));
+    }
+    for (auto& f : futures) {
+      result += f.get();
+    }
+
+    for (auto& part : removed_parts) {
+      if (has_event_index_) {
+        for (const auto& entry : part) {
+          RemoveFromIndex(entry.date, entry.event);
+        }
+      }
+      if (removed) {
+        removed->insert(removed->end(), make_move_iterator(part.begin()), make_move_iterator(part.end()));
+      }
+    }
+    if (result > 0) {
+      for (auto it = first; it != last; ) {
+        EraseIfEmpty(it++);
       }
     }
     return result;
   }
 
   template <typename Predicate>
-  vector<Entry> Findif (Predicate predicate) const {
+  vector<Entry> Findif (Predicate predicate, const DateRange& range = {}, const string* event = nullptr) const {
     vector<Entry> result;
-    for (auto& kv : data_) {
-      for (const auto& event : kv.second.GetAll()) {
-        if (predicate(kv.first, event)) {
-          result.push_back(Entry{kv.first, event});
-        }
+    if (range.IsEmpty()) {
+      return result;
+    }
+    if (event && has_event_index_) {
+      return FindIndexed(predicate, range, *event);
+    }
+    const auto parts = SplitRange(data_.lower_bound(range.first), data_.upper_bound(range.last));
+
+    vector<future<vector<Entry>>> futures;
+    for (size_t i = 1; i < parts.size(); ++i) {
+      futures.push_back(async(launch::async, [=] {
+        vector<Entry> part_result;
+        FindInRange(parts[i].first, parts[i].second, predicate, event, part_result);
+        return part_result;
+      }));
+    }
+    if (!parts.empty()) {
+      FindInRange(parts[0].first, parts[0].second, predicate, event, result);
+    }
+    // parts follow each other, so the entries stay sorted by date
+    for (auto& f : futures) {
+      auto part_result = f.get();
+      result.insert(result.end(), make_move_iterator(part_result.begin()), make_move_iterator(part_result.end()));
+    }
+    return result;
+  }
+
+  // Same as Findif, but the entries are seen in place instead of copied.
+  // The result is valid until the database is changed
+  template <typename Predicate>
+  vector<EntryView> FindViews(Predicate predicate, const DateRange& range = {},
+                              const string* event = nullptr) const {
+    vector<EntryView> result;
+    if (range.IsEmpty()) {
+      return result;
+    }
+    if (event && has_event_index_) {
+      for (const EntryView& entry : Select(predicate, range, event)) {
+        result.push_back(entry);
+      }
+      return result;
+    }
+    const auto parts = SplitRange(data_.lower_bound(range.first), data_.upper_bound(range.last));
+
+    vector<future<vector<EntryView>>> futures;
+    for (size_t i = 1; i < parts.size(); ++i) {
+      futures.push_back(async(launch::async, [=] {
+        vector<EntryView> part_result;
+        FindInRange(parts[i].first, parts[i].second, predicate, event, part_result);
+        return part_result;
+      }));
+    }
+    if (!parts.empty()) {
+      FindInRange(parts[0].first, parts[0].second, predicate, event, result);
+    }
+    // views can't be assigned, so they are appended one by one
+    for (auto& f : futures) {
+      for (const EntryView& entry : f.get()) {
+        result.push_back(entry);
       }
     }
     return result;
   }
 
+  // Lazy version of Findif: matches are checked while the result is walked
+  // and are seen in place, so nothing is copied. Walks a single thread.
+  // The result is valid until the database is changed
+  template <typename Predicate>
+  FindCursor<Predicate> Select(Predicate predicate, const DateRange& range = {},
+                               const string* event = nullptr) const {
+    if (range.IsEmpty()) {
+      return FindCursor<Predicate>(move(predicate));
+    }
+    if (event && has_event_index_) {
+      auto posting = event_index_.find(*event);
+      if (posting == event_index_.end()) {
+        return FindCursor<Predicate>(move(predicate));
+      }
+      const auto& dates = posting->second;
+      return FindCursor<Predicate>(move(predicate), dates.lower_bound(range.first),
+                                   dates.upper_bound(range.last), posting->first);
+    }
+    return FindCursor<Predicate>(move(predicate), data_.lower_bound(range.first),
+                                 data_.upper_bound(range.last), event);
+  }
+
+  // Number of entries Findif would return, without collecting them
+  template <typename Predicate>
+  size_t Countif (Predicate predicate, const DateRange& range = {}, const string* event = nullptr) const {
+    if (range.IsEmpty()) {
+      return 0;
+    }
+    if (event && has_event_index_) {
+      return Select(predicate, range, event).Count();
+    }
+    const auto parts = SplitRange(data_.lower_bound(range.first), data_.upper_bound(range.last));
+
+    vector<future<size_t>> futures;
+    for (size_t i = 1; i < parts.size(); ++i) {
+      futures.push_back(async(launch::async, [=] {
+        return FindCursor<Predicate>(predicate, parts[i].first, parts[i].second, event).Count();
+      }));
+    }
+    size_t result = 0;
+    if (!parts.empty()) {
+      result = FindCursor<Predicate>(predicate, parts[0].first, parts[0].second, event).Count();
+    }
+    for (auto& f : futures) {
+      result += f.get();
+    }
+    return result;
+  }
+
   void Print(ostream& os) const;
+  void Print(OutputWriter& out) const;
+
+  const map<Date, EventSet>& GetAll() const {
+    return data_;
+  }
 
-  // throws invalid_argument if there is no last event for the given date
+  // throws invalid_argument if there is no last event for the given date.
+  // Last may rebuild its cache, so it must not be called concurrently
   Entry Last(const Date& date) const;
+  // Same as Last, but refers to the stored entry instead of copying it
+  EntryView LastView(const Date& date) const;
 
  private:
+  // Threads get at least this many entries to check
+  static const size_t MIN_ENTRIES_PER_THREAD = 10'000;
+
+  // Splits [first, last) into at most thread_count_ consecutive parts
+  // with roughly the same number of entries
+  template <typename Iterator>
+  vector<pair<Iterator, Iterator>> SplitRange(Iterator first, Iterator last) const {
+    size_t entry_count = 0;
+    if (thread_count_ > 1) {
+      for (auto it = first; it != last; ++it) {
+        entry_count += it->second.GetAll().size();
+      }
+    }
+    const size_t part_count = max<size_t>(1, min(thread_count_, entry_count / MIN_ENTRIES_PER_THREAD));
+    const size_t part_size = entry_count / part_count;
+
+    vector<pair<Iterator, Iterator>> result;
+    if (first == last) {
+      return result;
+    }
+    Iterator part_begin = first;
+    size_t current_size = 0;
+    for (auto it = first; it != last; ++it) {
+      current_size += it->second.GetAll().size();
+      if (current_size >= part_size && result.size() + 1 < part_count) {
+        result.push_back({part_begin, next(it)});
+        part_begin = next(it);
+        current_size = 0;
+      }
+    }
+    if (part_begin != last) {
+      result.push_back({part_begin, last});
+    }
+    return result;
+  }
+
+  // Result is either Entry or EntryView
+  template <typename Iterator, typename Predicate, typename Result>
+  static void FindInRange(Iterator first, Iterator last, Predicate predicate, const string* event,
+                          vector<Result>& result) {
+    for (auto it = first; it != last; ++it) {
+      for (const auto& e : it->second.GetAll()) {
+        if ((!event || e == *event) && predicate(it->first, e)) {
+          result.push_back(Result{it->first, e});
+        }
+      }
+    }
+  }
+
+  // Doesn't erase dates left without events.
+  // Removed entries are collected if removed isn't nullptr
+  template <typename Iterator, typename Predicate>
+  static int RemoveInRange(Iterator first, Iterator last, Predicate predicate, const string* event,
+                           vector<Entry>* removed) {
+    int result = 0;
+    for (auto it = first; it != last; ++it) {
+      const Date& date = it->first;
+      auto matches = [=](const string& e) {
+        return (!event || e == *event) && predicate(date, e);
+      };
+      if (removed) {
+        result += it->second.Removeif (matches, [&](const string& e) {
+          removed->push_back({date, e});
+        });
+      } else {
+        result += it->second.Removeif (matches);
+      }
+    }
+    return result;
+  }
+
+  template <typename Predicate>
+  int RemoveIndexed(Predicate predicate, const DateRange& range, const string& event,
+                    vector<Entry>* removed) {
+    auto posting = event_index_.find(event);
+    if (posting == event_index_.end()) {
+      return 0;
+    }
+    int result = 0;
+    auto& dates = posting->second;
+    const auto last = dates.upper_bound(range.last);
+    for (auto it = dates.lower_bound(range.first); it != last; ) {
+      if (!predicate(*it, event)) {
+        ++it;
+        continue;
+      }
+      auto events = data_.find(*it);
+      events->second.Remove(event);
+      EraseIfEmpty(events);
+      if (removed) {
+        removed->push_back({*it, event});
+      }
+      dates.erase(it++);
+      ++result;
+    }
+    if (dates.empty()) {
+      event_index_.erase(posting);
+    }
+    return result;
+  }
+
+  template <typename Predicate>
+  vector<Entry> FindIndexed(Predicate predicate, const DateRange& range, const string& event) const {
+    vector<Entry> result;
+    auto posting = event_index_.find(event);
+    if (posting == event_index_.end()) {
+      return result;
+    }
+    const auto& dates = posting->second;
+    const auto last = dates.upper_bound(range.last);
+    for (auto it = dates.lower_bound(range.first); it != last; ++it) {
+      if (predicate(*it, posting->first)) {
+        result.push_back(Entry{*it, posting->first});
+      }
+    }
+    return result;
+  }
+
+  void RemoveFromIndex(const Date& date, const string& event);
+
+  // Erases the date if it has no events left. Any removal leaves the cache
+  // of Last stale, as the events after a removed one move
+  void EraseIfEmpty(map<Date, EventSet>::iterator it);
+
+  void RebuildLastCache() const;
+
+  // The last event of every date for Last, sorted by keys of dates,
+  // which are kept apart to make the binary search touch less memory.
+  // Adding dates in order keeps the cache, other changes only mark it stale.
+  // A stale cache is rebuilt in one pass over the dates once Last has been
+  // called often enough to pay for it, until then Last searches the map
+  struct LastEntry {
+    const Date* date;
+    const string* event;
+  };
+  mutable vector<int> last_keys_;
+  mutable vector<LastEntry> last_entries_;
+  mutable bool last_stale_ = false;
+  // calls of Last since the cache became stale
+  mutable size_t stale_queries_ = 0;
+  // Last can't use the cache while there are dates that don't fit into a key
+  mutable size_t unkeyed_dates_ = 0;
+
   map<Date, EventSet> data_;
+  size_t thread_count_ = 1;
+  bool has_event_index_ = false;
+  // event -> dates having this event
+  map<string, set<Date>> event_index_;
 };
 
 
@@ -69,3 +400,10 @@ void TestDatabaseAddAndPrint();
 void TestDatabaseFind();
 void TestDatabaseRemove();
 void TestDatabaseLast();
+void TestDatabaseDateRange();
+void TestDatabaseEventIndex();
+void TestDatabaseThreads();
+void TestDatabaseRemovedEntries();
+void TestDatabaseSelect();
+void TestDatabaseFindViews();
+void TestDatabaseLastCache();
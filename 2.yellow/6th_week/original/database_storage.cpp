@@ -0,0 +1,349 @@
+#include "database_storage.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <unistd.h>
+using namespace std;
+
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = {'E', 'V', 'D', 'B', 'S', 'N', 'P', '1'};
+const char LOG_MAGIC[8] = {'E', 'V', 'D', 'B', 'L', 'O', 'G', '2'};
+// records of this log have 32-bit lengths
+const char OLD_LOG_MAGIC[8] = {'E', 'V', 'D', 'B', 'L', 'O', 'G', '1'};
+const size_t LOG_HEADER_SIZE = sizeof(LOG_MAGIC) + sizeof(uint64_t);
+// length and checksum of the payload
+const size_t RECORD_HEADER_SIZE = sizeof(uint64_t) + sizeof(uint32_t);
+const size_t OLD_RECORD_HEADER_SIZE = 2 * sizeof(uint32_t);
+
+// FNV-1a
+uint32_t Checksum(const char* data, size_t size) {
+  uint32_t result = 2166136261u;
+  for (size_t i = 0; i < size; ++i) {
+    result = (result ^ static_cast<uint8_t>(data[i])) * 16777619u;
+  }
+  return result;
+}
+
+template <typename T>
+void Write(string& out, T value) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void WriteDate(string& out, const Date& date) {
+  Write<int32_t>(out, date.year);
+  Write<int32_t>(out, date.month);
+  Write<int32_t>(out, date.day);
+}
+
+void WriteEntry(string& out, const Date& date, const string& event) {
+  WriteDate(out, date);
+  Write<uint32_t>(out, event.size());
+  out += event;
+}
+
+// Reads values from a buffer, throws out_of_range when it ends
+class Reader {
+ public:
+  Reader(const char* begin, const char* end) : current_(begin), end_(end) {
+  }
+
+  template <typename T>
+  T Read() {
+    T value;
+    memcpy(&value, Take(sizeof(value)), sizeof(value));
+    return value;
+  }
+
+  Date ReadDate() {
+    Date date;
+    date.year = Read<int32_t>();
+    date.month = Read<int32_t>();
+    date.day = Read<int32_t>();
+    return date;
+  }
+
+  string_view ReadBytes(size_t size) {
+    return {Take(size), size};
+  }
+
+  size_t Left() const {
+    return end_ - current_;
+  }
+
+ private:
+  const char* Take(size_t size) {
+    if (Left() < size) {
+      throw out_of_range("Unexpected end of data");
+    }
+    const char* result = current_;
+    current_ += size;
+    return result;
+  }
+
+  const char* current_;
+  const char* end_;
+};
+
+vector<char> ReadFile(const string& path) {
+  ifstream input(path, ios::binary);
+  if (!input) {
+    return {};
+  }
+  input.seekg(0, ios::end);
+  vector<char> result(input.tellg());
+  input.seekg(0);
+  input.read(result.data(), result.size());
+  return result;
+}
+
+// Makes the written data of a file or the entries of a directory survive
+// a power loss. Streams don't give their descriptors, so the path is opened
+// again: fsync writes out the file, not just the descriptor
+void Sync(const string& path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw runtime_error("Can't open for sync: " + path);
+  }
+  const int result = fsync(fd);
+  close(fd);
+  if (result != 0) {
+    throw runtime_error("Can't sync: " + path);
+  }
+}
+
+string DirectoryOf(const string& path) {
+  const auto parent = filesystem::path(path).parent_path();
+  return parent.empty() ? "." : parent.string();
+}
+
+}
+
+DatabaseStorage::DatabaseStorage(const string& path)
+  : snapshot_path_(path + ".snapshot")
+  , log_path_(path + ".log") {
+}
+
+void DatabaseStorage::Load(Database& db) {
+  generation_ = LoadSnapshot(db);
+  bool old_log = false;
+  const uint64_t log_size = ReplayLog(db, generation_, old_log);
+  if (log_size == 0) {
+    StartLog();
+    return;
+  }
+  if (old_log) {
+    // new records must not follow records of the old format
+    WriteSnapshot(db);
+    return;
+  }
+  // cuts off a torn record, so that new records follow the valid ones
+  filesystem::resize_file(log_path_, log_size);
+  log_.open(log_path_, ios::binary | ios::app);
+}
+
+uint64_t DatabaseStorage::LoadSnapshot(Database& db) {
+  const vector<char> data = ReadFile(snapshot_path_);
+  if (data.empty()) {
+    return 0;
+  }
+  try {
+    if (data.size() < sizeof(uint32_t)) {
+      throw runtime_error("");
+    }
+    const char* const end = data.data() + data.size() - sizeof(uint32_t);
+    Reader reader(data.data(), end);
+    uint32_t checksum;
+    memcpy(&checksum, end, sizeof(checksum));
+    if (checksum != Checksum(data.data(), end - data.data())
+        || reader.ReadBytes(sizeof(SNAPSHOT_MAGIC)) != string_view(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC))) {
+      throw runtime_error("");
+    }
+    const auto generation = reader.Read<uint64_t>();
+
+    // every distinct event is stored once and referred to by its number
+    vector<string> events(reader.Read<uint32_t>());
+    for (auto& event : events) {
+      event = reader.ReadBytes(reader.Read<uint32_t>());
+    }
+    for (auto date_count = reader.Read<uint32_t>(); date_count > 0; --date_count) {
+      const Date date = reader.ReadDate();
+      // a whole date at once, its events are distinct in a valid snapshot
+      vector<string> date_events(reader.Read<uint32_t>());
+      vector<uint32_t> numbers(date_events.size());
+      for (size_t i = 0; i < date_events.size(); ++i) {
+        numbers[i] = reader.Read<uint32_t>();
+        date_events[i] = events.at(numbers[i]);
+      }
+      // numbers follow the order of strings
+      vector<uint32_t> sorted(numbers.size());
+      for (size_t i = 0; i < sorted.size(); ++i) {
+        sorted[i] = i;
+      }
+      sort(sorted.begin(), sorted.end(), [&numbers](uint32_t lhs, uint32_t rhs) {
+        return numbers[lhs] < numbers[rhs];
+      });
+      db.AddDate(date, EventSet(move(date_events), sorted));
+    }
+    return generation;
+  } catch (exception&) {
+    throw runtime_error("Damaged snapshot: " + snapshot_path_);
+  }
+}
+
+uint64_t DatabaseStorage::ReplayLog(Database& db, uint64_t generation, bool& old_log) {
+  const vector<char> data = ReadFile(log_path_);
+  if (data.size() < LOG_HEADER_SIZE) {
+    return 0;
+  }
+  old_log = memcmp(data.data(), OLD_LOG_MAGIC, sizeof(OLD_LOG_MAGIC)) == 0;
+  if (!old_log && memcmp(data.data(), LOG_MAGIC, sizeof(LOG_MAGIC)) != 0) {
+    return 0;
+  }
+  Reader reader(data.data() + sizeof(LOG_MAGIC), data.data() + data.size());
+  // the snapshot was written after this log
+  if (reader.Read<uint64_t>() != generation) {
+    return 0;
+  }
+
+  const size_t record_header_size = old_log ? OLD_RECORD_HEADER_SIZE : RECORD_HEADER_SIZE;
+  uint64_t valid_size = LOG_HEADER_SIZE;
+  while (reader.Left() >= record_header_size) {
+    const uint64_t size = old_log ? reader.Read<uint32_t>() : reader.Read<uint64_t>();
+    const auto checksum = reader.Read<uint32_t>();
+    if (reader.Left() < size) {
+      break;
+    }
+    const string_view payload = reader.ReadBytes(size);
+    if (checksum != Checksum(payload.data(), payload.size())) {
+      break;
+    }
+
+    // the checksum has matched, so the record is complete
+    Reader record(payload.data(), payload.data() + payload.size());
+    const auto type = static_cast<RecordType>(record.Read<uint8_t>());
+    while (record.Left() > 0) {
+      const Date date = record.ReadDate();
+      const string event(record.ReadBytes(record.Read<uint32_t>()));
+      if (type == RecordType::Add) {
+        db.Add(date, event);
+      } else {
+        db.Removeif ([](const Date&, const string&) { return true; }, {date, date}, &event);
+      }
+    }
+    valid_size += record_header_size + size;
+    ++log_records_;
+  }
+  return valid_size;
+}
+
+void DatabaseStorage::StartLog() {
+  log_.close();
+  log_.open(log_path_, ios::binary | ios::trunc);
+  string header(LOG_MAGIC, sizeof(LOG_MAGIC));
+  Write<uint64_t>(header, generation_);
+  log_.write(header.data(), header.size());
+  Flush();
+  // the log may be new
+  Sync(DirectoryOf(log_path_));
+  log_records_ = 0;
+}
+
+void DatabaseStorage::LogAdd(const Date& date, const string& event) {
+  StartRecord(RecordType::Add);
+  WriteEntry(record_, date, event);
+  FinishRecord();
+}
+
+void DatabaseStorage::LogRemove(const vector<Entry>& entries) {
+  if (entries.empty()) {
+    return;
+  }
+  StartRecord(RecordType::Remove);
+  for (const auto& entry : entries) {
+    WriteEntry(record_, entry.date, entry.event);
+  }
+  FinishRecord();
+}
+
+void DatabaseStorage::StartRecord(RecordType type) {
+  record_.assign(RECORD_HEADER_SIZE, '\0');
+  Write(record_, type);
+}
+
+void DatabaseStorage::FinishRecord() {
+  const uint64_t size = record_.size() - RECORD_HEADER_SIZE;
+  const uint32_t checksum = Checksum(record_.data() + RECORD_HEADER_SIZE, size);
+  memcpy(&record_[0], &size, sizeof(size));
+  memcpy(&record_[sizeof(size)], &checksum, sizeof(checksum));
+  log_.write(record_.data(), record_.size());
+  ++log_records_;
+}
+
+void DatabaseStorage::Flush() {
+  if (!log_.flush()) {
+    throw runtime_error("Can't write log: " + log_path_);
+  }
+  Sync(log_path_);
+}
+
+void DatabaseStorage::WriteSnapshot(const Database& db) {
+  const auto& data = db.GetAll();
+
+  // events are numbered in the order of strings,
+  // so that Load sorts the events of a date by their numbers
+  unordered_map<string_view, uint32_t> event_numbers;
+  vector<string_view> sorted_events;
+  for (const auto& kv : data) {
+    for (const auto& event : kv.second.GetAll()) {
+      if (event_numbers.emplace(event, 0).second) {
+        sorted_events.push_back(event);
+      }
+    }
+  }
+  sort(sorted_events.begin(), sorted_events.end());
+  string events;
+  for (size_t number = 0; number < sorted_events.size(); ++number) {
+    event_numbers[sorted_events[number]] = number;
+    Write<uint32_t>(events, sorted_events[number].size());
+    events += sorted_events[number];
+  }
+
+  string snapshot(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+  Write<uint64_t>(snapshot, generation_ + 1);
+  Write<uint32_t>(snapshot, event_numbers.size());
+  snapshot += events;
+  Write<uint32_t>(snapshot, data.size());
+  for (const auto& kv : data) {
+    WriteDate(snapshot, kv.first);
+    Write<uint32_t>(snapshot, kv.second.GetAll().size());
+    for (const auto& event : kv.second.GetAll()) {
+      Write<uint32_t>(snapshot, event_numbers.at(event));
+    }
+  }
+  Write<uint32_t>(snapshot, Checksum(snapshot.data(), snapshot.size()));
+
+  const string temporary_path = snapshot_path_ + ".tmp";
+  {
+    ofstream output(temporary_path, ios::binary | ios::trunc);
+    output.write(snapshot.data(), snapshot.size());
+    if (!output.flush()) {
+      throw runtime_error("Can't write snapshot: " + temporary_path);
+    }
+  }
+  // otherwise the rename may reach the disk before the data it points to
+  Sync(temporary_path);
+  filesystem::rename(temporary_path, snapshot_path_);
+  Sync(DirectoryOf(snapshot_path_));
+
+  // a crash before the new log is started leaves the old one,
+  // which is skipped on Load because of its generation
+  ++generation_;
+  StartLog();
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "database.h"
+#include "date.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Keeps a Database in two binary files, so that it survives restarts:
+//   path + ".snapshot" holds the whole database at some moment,
+//   path + ".log" holds changes made after that moment.
+// Every log record has its length and checksum, so a record torn by a crash
+// is found on Load and cut off together with everything after it.
+// Entries removed by one call of LogRemove share a record, so that
+// a removal is either replayed completely or not at all.
+// Numbers are written in the byte order of the machine.
+class DatabaseStorage {
+ public:
+  explicit DatabaseStorage(const string& path);
+
+  // Loads the snapshot into the empty db, replays the log after it
+  // and opens the log for appending.
+  // throws runtime_error if the snapshot is damaged
+  void Load(Database& db);
+
+  void LogAdd(const Date& date, const string& event);
+  void LogRemove(const vector<Entry>& entries);
+  // Logged changes are buffered until this call, which returns
+  // when they are on the disk.
+  // throws runtime_error if they can't be written
+  void Flush();
+
+  // Changes logged since the last snapshot
+  size_t GetLogSize() const {
+    return log_records_;
+  }
+
+  // Writes the db into a new snapshot and starts an empty log.
+  // The old snapshot is replaced only when the new one is on the disk
+  void WriteSnapshot(const Database& db);
+
+ private:
+  enum class RecordType : uint8_t {
+    Add,
+    Remove,
+  };
+
+  // A record is a type followed by entries, it is built in record_
+  void StartRecord(RecordType type);
+  void FinishRecord();
+  // Returns the generation of the snapshot, 0 if there is none
+  uint64_t LoadSnapshot(Database& db);
+  // Replays valid records and returns the size of the log they take,
+  // old_log is set if the records have 32-bit lengths
+  uint64_t ReplayLog(Database& db, uint64_t generation, bool& old_log);
+  void StartLog();
+
+  string snapshot_path_;
+  string log_path_;
+  // changes from logs of older generations are already in the snapshot
+  uint64_t generation_ = 0;
+  size_t log_records_ = 0;
+  ofstream log_;
+  string record_;
+};
+
+
+// Tests
+void TestDatabaseStorageRestore();
+void TestDatabaseStorageSnapshot();
+void TestDatabaseStorageTruncatedLog();
@@ -0,0 +1,207 @@
+#include "database_storage.h"
+#include "test_runner.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+using namespace std;
+
+// A directory of its own for every test, so that runs at once don't clash
+class TestDirectory {
+ public:
+  TestDirectory() {
+    string pattern = (filesystem::temp_directory_path() / "database_storage_test.XXXXXX").string();
+    if (!mkdtemp(pattern.data())) {
+      throw runtime_error("Can't create a directory from " + pattern);
+    }
+    path_ = pattern;
+  }
+
+  ~TestDirectory() {
+    filesystem::remove_all(path_);
+  }
+
+  // prefix of the files of a DatabaseStorage
+  string GetStoragePath() const {
+    return path_ + "/database";
+  }
+
+ private:
+  string path_;
+};
+
+string PrintDatabase(const Database& db) {
+  ostringstream os;
+  db.Print(os);
+  return os.str();
+}
+
+// Adds the entry to the database and to its log
+void AddLogged(Database& db, DatabaseStorage& storage, const Date& date, const string& event) {
+  if (db.Add(date, event)) {
+    storage.LogAdd(date, event);
+  }
+}
+
+template <typename Predicate>
+void RemoveLogged(Database& db, DatabaseStorage& storage, Predicate predicate) {
+  vector<Entry> removed;
+  db.Removeif (predicate, {}, nullptr, &removed);
+  storage.LogRemove(removed);
+}
+
+void TestDatabaseStorageRestore() {
+  const TestDirectory directory;
+  const string path = directory.GetStoragePath();
+  string expected;
+  {
+    Database db;
+    DatabaseStorage storage(path);
+    storage.Load(db);
+    AssertEqual(PrintDatabase(db), "", "Storage restore: nothing is stored yet");
+
+    AddLogged(db, storage, {2017, 11, 21}, "Tuesday");
+    AddLogged(db, storage, {2017, 11, 20}, "Monday");
+    AddLogged(db, storage, {2017, 11, 21}, "Weekly meeting");
+    AddLogged(db, storage, {2017, 11, 21}, "Tuesday");
+    RemoveLogged(db, storage, [](const Date&, const string& event) { return event == "Tuesday"; });
+    AddLogged(db, storage, {2017, 11, 21}, "Tuesday");
+    storage.Flush();
+    AssertEqual(storage.GetLogSize(), 5u, "Storage restore: log size without the repeated add");
+    expected = PrintDatabase(db);
+  } {
+    Database db;
+    DatabaseStorage storage(path);
+    storage.Load(db);
+    AssertEqual(PrintDatabase(db), expected, "Storage restore: log is replayed in order");
+    AddLogged(db, storage, {2017, 1, 1}, "Holiday");
+    storage.Flush();
+    expected = PrintDatabase(db);
+  } {
+    Database db;
+    db.EnableEventIndex();
+    DatabaseStorage storage(path);
+    storage.Load(db);
+    AssertEqual(PrintDatabase(db), expected, "Storage restore: records are appended after reopening");
+    const string event = "Holiday";
+    AssertEqual(db.Findif ([](const Date&, const string&) { return true; }, {}, &event),
+                vector<Entry>{{{2017, 1, 1}, "Holiday"}}, "Storage restore: loaded entries are indexed");
+  }
+}
+
+void TestDatabaseStorageSnapshot() {
+  const TestDirectory directory;
+  const string path = directory.GetStoragePath();
+  string expected;
+  {
+    Database db;
+    DatabaseStorage storage(path);
+    storage.Load(db);
+    for (int i = 0; i < 100; ++i) {
+      AddLogged(db, storage, {2017, 1 + i % 12, 1 + i % 28}, "event " + to_string(i % 7));
+    }
+    storage.WriteSnapshot(db);
+    AssertEqual(storage.GetLogSize(), 0u, "Storage snapshot: log is emptied");
+
+    RemoveLogged(db, storage, [](const Date& date, const string&) { return date.month == 3; });
+    AddLogged(db, storage, {2016, 2, 29}, "event 3");
+    storage.Flush();
+    AssertEqual(storage.GetLogSize(), 2u, "Storage snapshot: log tail");
+    expected = PrintDatabase(db);
+  } {
+    Database db;
+    DatabaseStorage storage(path);
+    storage.Load(db);
+    AssertEqual(PrintDatabase(db), expected, "Storage snapshot: snapshot and log tail");
+    AssertEqual(storage.GetLogSize(), 2u, "Storage snapshot: only the tail is replayed");
+    storage.WriteSnapshot(db);
+  } {
+    // as if the process stopped between writing the snapshot and starting a new log
+    const string old_log = path + ".old_log";
+    filesystem::copy_file(path + ".log", old_log);
+    {
+      Database db;
+      DatabaseStorage storage(path);
+      storage.Load(db);
+      AddLogged(db, storage, {2018, 1, 1}, "event 1");
+      storage.Flush();
+      storage.WriteSnapshot(db);
+    }
+    filesystem::rename(old_log, path + ".log");
+
+    Database db;
+    DatabaseStorage storage(path);
+    storage.Load(db);
+    AssertEqual(PrintDatabase(db), expected + "2018-01-01 event 1\n", "Storage snapshot: old log is skipped");
+  } {
+    filesystem::resize_file(path + ".snapshot", filesystem::file_size(path + ".snapshot") - 1);
+    Database db;
+    DatabaseStorage storage(path);
+    bool wasException = false;
+    try {
+      storage.Load(db);
+    } catch (runtime_error&) {
+      wasException = true;
+    }
+    Assert(wasException, "Storage snapshot: damaged snapshot isn't loaded");
+  }
+}
+
+void TestDatabaseStorageTruncatedLog() {
+  const TestDirectory directory;
+  const string path = directory.GetStoragePath();
+  // states of the database after every logged change
+  vector<string> states;
+  {
+    Database db;
+    DatabaseStorage storage(path);
+    storage.Load(db);
+    states.push_back(PrintDatabase(db));
+    for (int i = 0; i < 30; ++i) {
+      if (i % 10 == 9) {
+        RemoveLogged(db, storage, [i](const Date& date, const string&) { return date.day == i % 4 + 1; });
+      } else {
+        AddLogged(db, storage, {2017, 1, i % 4 + 1}, string(i % 5, 'a') + to_string(i));
+      }
+      storage.Flush();
+      states.push_back(PrintDatabase(db));
+    }
+  }
+  const string full_log = path + ".full_log";
+  filesystem::copy_file(path + ".log", full_log);
+  const auto full_size = filesystem::file_size(full_log);
+
+  size_t last_state = 0;
+  for (uintmax_t size = 0; size <= full_size; ++size) {
+    filesystem::copy_file(full_log, path + ".log", filesystem::copy_options::overwrite_existing);
+    filesystem::resize_file(path + ".log", size);
+
+    const string hint = "Storage truncated log: size " + to_string(size);
+    string recovered;
+    {
+      Database db;
+      DatabaseStorage storage(path);
+      storage.Load(db);
+      recovered = PrintDatabase(db);
+      // a crash loses only the changes after the cut
+      size_t state = last_state;
+      while (state < states.size() && states[state] != recovered) {
+        ++state;
+      }
+      Assert(state < states.size(), hint + ", state isn't a prefix of changes");
+      last_state = state;
+
+      AddLogged(db, storage, {2018, 1, 1}, "after recovery");
+      storage.Flush();
+      recovered = PrintDatabase(db);
+    }
+    Database db;
+    DatabaseStorage storage(path);
+    storage.Load(db);
+    AssertEqual(PrintDatabase(db), recovered, hint + ", records after recovery");
+  }
+  AssertEqual(last_state, states.size() - 1, "Storage truncated log: full log");
+}
@@ -1,6 +1,7 @@
 #include "database.h"
 #include "test_runner.h"
 
+#include <random>
 #include <string>
 #include <sstream>
 #include <vector>
@@ -51,10 +52,10 @@ void TestDatabaseAddAndPrint() { {
     AssertEqual(os.str(), expected, "Database print: multiple events at single date");
   } {
     Database db;
-    db.Add({2017, 3, 1}, "01.03 1");
-    db.Add({2017, 3, 1}, "01.03 2");
-    db.Add({2017, 3, 1}, "01.03 1");
-    db.Add({2017, 3, 1}, "01.03 1");
+    Assert(db.Add({2017, 3, 1}, "01.03 1"), "Database add: new event");
+    Assert(db.Add({2017, 3, 1}, "01.03 2"), "Database add: new event at the same date");
+    Assert(!db.Add({2017, 3, 1}, "01.03 1"), "Database add: repeated event");
+    Assert(!db.Add({2017, 3, 1}, "01.03 1"), "Database add: repeated event again");
 
     ostringstream os;
     db.Print(os);
@@ -202,3 +203,342 @@ void TestDatabaseLast() { {
     AssertEqual(db.Last({2017, 11, 17}), Entry{{2016, 11, 17}, "Thursday"}, "Database last and remove 2");
   }
 }
+
+void TestDatabaseDateRange() {
+  Database db;
+  db.Add({2016, 12, 31}, "New Year's Eve");
+  db.Add({2017, 1, 1}, "New Year");
+  db.Add({2017, 1, 7}, "Christmas");
+  db.Add({2017, 2, 23}, "Defender of the Fatherland Day");
+
+  auto alwaysTrue = [](const Date&, const string&) { return true; };
+  const DateRange january{{2017, 1, 1}, {2017, 1, 31}};
+
+  const vector<Entry> expected = {{{2017, 1, 1}, "New Year"}, {{2017, 1, 7}, "Christmas"}};
+  AssertEqual(db.Findif (alwaysTrue, january), expected, "Database date range: find");
+  AssertEqual(db.Findif (alwaysTrue, Intersect(january, {{2017, 2, 1}, {2017, 2, 28}})), vector<Entry>(),
+              "Database date range: find in empty range");
+
+  int checked = 0;
+  auto countChecked = [&checked](const Date&, const string&) { ++checked; return false; };
+  db.Findif (countChecked, {{2017, 1, 2}, {2017, 1, 6}});
+  AssertEqual(checked, 0, "Database date range: dates outside of the range aren't checked");
+
+  AssertEqual(db.Removeif (alwaysTrue, january), 2, "Database date range: remove");
+  ostringstream os;
+  db.Print(os);
+  AssertEqual(os.str(), "2016-12-31 New Year's Eve\n2017-02-23 Defender of the Fatherland Day\n",
+              "Database date range: entries outside of the range are kept");
+}
+
+void TestDatabaseEventIndex() {
+  auto alwaysTrue = [](const Date&, const string&) { return true; };
+  const string holiday = "holiday";
+  {
+    Database db;
+    db.Add({2017, 1, 1}, "holiday");
+    db.Add({2017, 1, 1}, "workday");
+    db.EnableEventIndex();
+    db.Add({2017, 1, 7}, "holiday");
+    db.Add({2017, 1, 9}, "workday");
+    Assert(db.HasEventIndex(), "Database event index: enabled");
+
+    const vector<Entry> expected = {{{2017, 1, 1}, "holiday"}, {{2017, 1, 7}, "holiday"}};
+    AssertEqual(db.Findif (alwaysTrue, {}, &holiday), expected, "Database event index: find");
+    AssertEqual(db.Findif (alwaysTrue, {{2017, 1, 2}, {2017, 1, 31}}, &holiday), vector<Entry>{expected[1]},
+                "Database event index: find in date range");
+
+    int checked = 0;
+    auto countChecked = [&checked](const Date&, const string&) { ++checked; return false; };
+    db.Findif (countChecked, {}, &holiday);
+    AssertEqual(checked, 2, "Database event index: only entries with the event are checked");
+
+    AssertEqual(db.Removeif (alwaysTrue, {{2017, 1, 1}, {2017, 1, 1}}, &holiday), 1, "Database event index: remove");
+    ostringstream os;
+    db.Print(os);
+    AssertEqual(os.str(), "2017-01-01 workday\n2017-01-07 holiday\n2017-01-09 workday\n",
+                "Database event index: other events are kept");
+  } {
+    Database db;
+    db.EnableEventIndex();
+    db.Add({2017, 1, 1}, "holiday");
+    db.Add({2017, 1, 2}, "holiday");
+    db.Removeif ([](const Date& date, const string&) { return date.day == 1; });
+    AssertEqual(db.Findif (alwaysTrue, {}, &holiday), vector<Entry>{{{2017, 1, 2}, "holiday"}},
+                "Database event index: updated on remove without index");
+
+    db.Removeif (alwaysTrue);
+    AssertEqual(db.Findif (alwaysTrue, {}, &holiday), vector<Entry>(), "Database event index: removed all");
+    db.Add({2017, 1, 3}, "holiday");
+    AssertEqual(db.Findif (alwaysTrue, {}, &holiday), vector<Entry>{{{2017, 1, 3}, "holiday"}},
+                "Database event index: added after removal");
+    AssertEqual(db.Last({2017, 1, 3}), Entry{{2017, 1, 3}, "holiday"}, "Database event index: last");
+  } {
+    Database db;
+    db.Add({2017, 1, 1}, "holiday");
+    db.Add({2017, 1, 1}, "workday");
+    AssertEqual(db.Findif (alwaysTrue, {}, &holiday), vector<Entry>{{{2017, 1, 1}, "holiday"}},
+                "Database event index: event filter without index");
+  } {
+    Database indexed, plain;
+    indexed.EnableEventIndex();
+    const vector<string> events = {"a", "b", "c", "d"};
+    for (int i = 0; i < 200; ++i) {
+      const Date date{2017, 1 + i % 3, 1 + i * 7 % 10};
+      const string& event = events[i * 13 % events.size()];
+      indexed.Add(date, event);
+      plain.Add(date, event);
+      if (i % 17 == 0) {
+        auto predicate = [i](const Date& date, const string&) { return date.day == 1 + i % 10; };
+        AssertEqual(indexed.Removeif (predicate), plain.Removeif (predicate), "Database event index: random remove");
+      }
+      if (i % 23 == 0) {
+        const string& removed = events[i % events.size()];
+        auto predicate = [&removed](const Date&, const string& e) { return e == removed; };
+        AssertEqual(indexed.Removeif (predicate, {}, &removed), plain.Removeif (predicate),
+                    "Database event index: random indexed remove");
+      }
+    }
+    for (const string& event : events) {
+      auto predicate = [&event](const Date&, const string& e) { return e == event; };
+      AssertEqual(indexed.Findif (predicate, {}, &event), plain.Findif (predicate),
+                  "Database event index: random find " + event);
+    }
+  }
+}
+
+void TestDatabaseThreads() {
+  // enough entries to give every thread a part
+  Database sequential, parallel;
+  parallel.SetThreadCount(4);
+  AssertEqual(parallel.GetThreadCount(), 4u, "Database threads: thread count");
+  for (int i = 0; i < 100'000; ++i) {
+    const Date date{2000 + i % 20, 1 + i % 12, 1 + i % 28};
+    const string event = "event " + to_string(i % 1'000);
+    sequential.Add(date, event);
+    parallel.Add(date, event);
+  }
+
+  auto evenEvents = [](const Date&, const string& event) { return event.back() % 2 == 0; };
+  auto lateDays = [](const Date& date, const string&) { return date.day > 20; };
+  const DateRange range{{2005, 1, 1}, {2014, 12, 31}};
+
+  AssertEqual(parallel.Findif (evenEvents), sequential.Findif (evenEvents), "Database threads: find");
+  AssertEqual(parallel.Findif (lateDays, range), sequential.Findif (lateDays, range),
+              "Database threads: find in date range");
+
+  AssertEqual(parallel.Removeif (lateDays, range), sequential.Removeif (lateDays, range),
+              "Database threads: remove in date range");
+  AssertEqual(parallel.Removeif (evenEvents), sequential.Removeif (evenEvents), "Database threads: remove");
+
+  ostringstream parallel_os, sequential_os;
+  parallel.Print(parallel_os);
+  sequential.Print(sequential_os);
+  Assert(parallel_os.str() == sequential_os.str(), "Database threads: print after remove");
+  AssertEqual(parallel.Last({2010, 1, 1}), sequential.Last({2010, 1, 1}), "Database threads: last after remove");
+
+  parallel.EnableEventIndex();
+  sequential.EnableEventIndex();
+  auto odd_days = [](const Date& date, const string&) { return date.day % 2 == 1; };
+  AssertEqual(parallel.Removeif (odd_days), sequential.Removeif (odd_days), "Database threads: remove with index");
+  const string event = "event 1";
+  auto alwaysTrue = [](const Date&, const string&) { return true; };
+  AssertEqual(parallel.Findif (alwaysTrue, {}, &event), sequential.Findif (alwaysTrue, {}, &event),
+              "Database threads: index after remove");
+}
+
+void TestDatabaseRemovedEntries() {
+  for (size_t thread_count : {1, 4}) {
+    for (bool with_index : {false, true}) {
+      Database db;
+      db.SetThreadCount(thread_count);
+      if (with_index) {
+        db.EnableEventIndex();
+      }
+      for (int i = 0; i < 30'000; ++i) {
+        db.Add({2017, 1 + i % 12, 1 + i % 28}, "event " + to_string(i % 100));
+      }
+      const string hint = "with " + to_string(thread_count) + " threads" + (with_index ? " and index" : "");
+
+      auto lateDays = [](const Date& date, const string&) { return date.day > 20; };
+      const auto expected = db.Findif (lateDays);
+      vector<Entry> removed;
+      AssertEqual(db.Removeif (lateDays, {}, nullptr, &removed), static_cast<int>(expected.size()),
+                  "Database removed entries: count " + hint);
+      AssertEqual(removed, expected, "Database removed entries: scan " + hint);
+
+      const string event = "event 7";
+      auto alwaysTrue = [](const Date&, const string&) { return true; };
+      const auto expected_event = db.Findif (alwaysTrue, {}, &event);
+      removed.clear();
+      db.Removeif (alwaysTrue, {}, &event, &removed);
+      AssertEqual(removed, expected_event, "Database removed entries: single event " + hint);
+    }
+  }
+}
+
+template <typename Range>
+vector<Entry> CopyEntries(const Range& range) {
+  vector<Entry> result;
+  for (const EntryView& entry : range) {
+    result.push_back({entry.date, entry.event});
+  }
+  return result;
+}
+
+void TestDatabaseSelect() {
+  for (bool with_index : {false, true}) {
+    Database db;
+    db.SetThreadCount(4);
+    for (int i = 0; i < 30'000; ++i) {
+      db.Add({2017, 1 + i % 12, 1 + i % 28}, "event " + to_string(i % 100));
+    }
+    if (with_index) {
+      db.EnableEventIndex();
+    }
+    const string hint = with_index ? " with index" : "";
+
+    auto lateDays = [](const Date& date, const string&) { return date.day > 20; };
+    auto alwaysTrue = [](const Date&, const string&) { return true; };
+    auto acceptsNothing = [](const Date&, const string&) { return false; };
+    const DateRange spring{{2017, 3, 1}, {2017, 5, 31}};
+    const string event = "event 7";
+    const string missing = "no such event";
+
+    AssertEqual(CopyEntries(db.Select(lateDays)), db.Findif (lateDays), "Database select: all dates" + hint);
+    AssertEqual(CopyEntries(db.Select(lateDays, spring)), db.Findif (lateDays, spring),
+                "Database select: date range" + hint);
+    AssertEqual(CopyEntries(db.Select(alwaysTrue, spring, &event)), db.Findif (alwaysTrue, spring, &event),
+                "Database select: single event" + hint);
+    AssertEqual(CopyEntries(db.Select(alwaysTrue, {}, &missing)), vector<Entry>(),
+                "Database select: missing event" + hint);
+    AssertEqual(CopyEntries(db.Select(acceptsNothing)), vector<Entry>(), "Database select: nothing" + hint);
+    AssertEqual(CopyEntries(db.Select(alwaysTrue, {{2018, 1, 1}, {2017, 1, 1}})), vector<Entry>(),
+                "Database select: empty range" + hint);
+
+    AssertEqual(db.Countif (lateDays), db.Findif (lateDays).size(), "Database count" + hint);
+    AssertEqual(db.Countif (alwaysTrue, spring, &event), db.Findif (alwaysTrue, spring, &event).size(),
+                "Database count: single event" + hint);
+    AssertEqual(db.Select(lateDays, spring).Count(), db.Findif (lateDays, spring).size(),
+                "Database select: count" + hint);
+
+    const auto all = db.Findif (lateDays);
+    const auto cursor = db.Select(lateDays);
+    for (size_t offset : {0u, 1u, 5'000u, 10'000u}) {
+      const size_t limit = 1'234;
+      const vector<Entry> expected(all.begin() + min(offset, all.size()),
+                                   all.begin() + min(offset + limit, all.size()));
+      AssertEqual(CopyEntries(cursor.Page(offset, limit)), expected,
+                  "Database select: page at " + to_string(offset) + hint);
+    }
+
+    vector<Entry> paged;
+    size_t page_count = 0;
+    for (const auto& page : Paginate(cursor, 1'000)) {
+      const auto entries = CopyEntries(page);
+      Assert(!entries.empty() && entries.size() <= 1'000, "Database select: page size" + hint);
+      paged.insert(paged.end(), entries.begin(), entries.end());
+      ++page_count;
+    }
+    AssertEqual(paged, all, "Database select: pages" + hint);
+    AssertEqual(page_count, (all.size() + 999) / 1'000, "Database select: page count" + hint);
+  }
+}
+
+void TestDatabaseFindViews() {
+  for (size_t thread_count : {1u, 4u}) {
+    for (bool with_index : {false, true}) {
+      Database db;
+      db.SetThreadCount(thread_count);
+      for (int i = 0; i < 100'000; ++i) {
+        db.Add({2000 + i % 20, 1 + i % 12, 1 + i % 28}, "event " + to_string(i % 1'000));
+      }
+      if (with_index) {
+        db.EnableEventIndex();
+      }
+      const string hint = " with " + to_string(thread_count) + " threads" + (with_index ? " and index" : "");
+
+      auto lateDays = [](const Date& date, const string&) { return date.day > 20; };
+      auto alwaysTrue = [](const Date&, const string&) { return true; };
+      const DateRange range{{2005, 1, 1}, {2014, 12, 31}};
+      const string event = "event 7";
+
+      AssertEqual(CopyEntries(db.FindViews(lateDays)), db.Findif (lateDays), "Database find views" + hint);
+      AssertEqual(CopyEntries(db.FindViews(lateDays, range)), db.Findif (lateDays, range),
+                  "Database find views: date range" + hint);
+      AssertEqual(CopyEntries(db.FindViews(alwaysTrue, range, &event)), db.Findif (alwaysTrue, range, &event),
+                  "Database find views: single event" + hint);
+      AssertEqual(CopyEntries(db.FindViews(alwaysTrue, {{2018, 1, 1}, {2017, 1, 1}})), vector<Entry>(),
+                  "Database find views: empty range" + hint);
+    }
+  }
+}
+
+// Last found straight in the map of dates
+Entry LastInMap(const Database& db, const Date& date) {
+  const auto& data = db.GetAll();
+  auto it = data.upper_bound(date);
+  if (it == data.begin()) {
+    throw invalid_argument("");
+  }
+  --it;
+  return {it->first, it->second.GetAll().back()};
+}
+
+void TestDatabaseLastCache() {
+  mt19937 gen(20171120);
+  uniform_int_distribution<int> year(2015, 2018);
+  uniform_int_distribution<int> month(1, 12);
+  uniform_int_distribution<int> day(1, 31);
+  uniform_int_distribution<int> event(0, 20);
+  uniform_int_distribution<int> operation(0, 9);
+
+  for (bool with_index : {false, true}) {
+    Database db;
+    if (with_index) {
+      db.EnableEventIndex();
+    }
+    for (int i = 0; i < 3'000; ++i) {
+      const Date date{year(gen), month(gen), day(gen)};
+      const int op = operation(gen);
+      if (op < 6) {
+        db.Add(date, "event " + to_string(event(gen)));
+      } else if (op == 6) {
+        db.Removeif ([](const Date&, const string&) { return true; }, {date, date});
+      } else if (op == 7) {
+        const string e = "event " + to_string(event(gen));
+        db.Removeif ([](const Date&, const string&) { return true; }, {}, &e);
+      } else if (op == 8) {
+        const int e = event(gen);
+        db.Removeif ([e](const Date& date, const string&) { return date.day % 21 == e; });
+      } else if (i % 100 == 9) {
+        // out of the range of date keys, Last works without the cache while it is there
+        const Date odd_date{date.year, date.month + 20, date.day * 3};
+        db.Add(odd_date, "odd");
+        db.Add(odd_date, "odd 2");
+        AssertEqual(db.Last(odd_date), Entry{odd_date, "odd 2"}, "Database last cache: odd date");
+        db.Removeif ([&odd_date](const Date& date, const string&) { return date == odd_date; });
+      }
+
+      // enough queries for a stale cache to be rebuilt now and then
+      for (int q = 0; q < 10; ++q) {
+        const Date query{year(gen), month(gen), day(gen)};
+        const string hint = "Database last cache: step " + to_string(i) + (with_index ? " with index" : "");
+        try {
+          const Entry expected = LastInMap(db, query);
+          AssertEqual(db.Last(query), expected, hint);
+          const EntryView view = db.LastView(query);
+          AssertEqual(Entry{view.date, view.event}, expected, hint + ", view");
+        } catch (invalid_argument&) {
+          bool wasException = false;
+          try {
+            db.Last(query);
+          } catch (invalid_argument&) {
+            wasException = true;
+          }
+          Assert(wasException, hint + ", no entries");
+        }
+      }
+    }
+  }
+}
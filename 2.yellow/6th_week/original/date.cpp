@@ -1,5 +1,7 @@
 #include "date.h"
 
+#include <algorithm>
+#include <cctype>
 #include <iomanip>
 #include <tuple>
 using namespace std;
@@ -14,6 +16,58 @@ Date ParseDate(istream& is) {
   return result;
 }
 
+DateRange Intersect(const DateRange& lhs, const DateRange& rhs) {
+  return {max(lhs.first, rhs.first), min(lhs.last, rhs.last)};
+}
+
+DateRange Unite(const DateRange& lhs, const DateRange& rhs) {
+  if (lhs.IsEmpty()) {
+    return rhs;
+  }
+  if (rhs.IsEmpty()) {
+    return lhs;
+  }
+  return {min(lhs.first, rhs.first), max(lhs.last, rhs.last)};
+}
+
+// Reads an integer the way operator >> does: skips spaces, accepts a sign
+// and gives the largest or the smallest int on overflow
+int ParseInt(string_view& sv) {
+  while (!sv.empty() && isspace(static_cast<unsigned char>(sv.front()))) {
+    sv.remove_prefix(1);
+  }
+  bool negative = false;
+  if (!sv.empty() && (sv.front() == '-' || sv.front() == '+')) {
+    negative = sv.front() == '-';
+    sv.remove_prefix(1);
+  }
+  int result = 0;
+  bool overflow = false;
+  while (!sv.empty() && isdigit(static_cast<unsigned char>(sv.front()))) {
+    const int digit = sv.front() - '0';
+    if (result > (numeric_limits<int>::max() - digit) / 10) {
+      overflow = true;
+    } else {
+      result = result * 10 + digit;
+    }
+    sv.remove_prefix(1);
+  }
+  if (overflow) {
+    return negative ? numeric_limits<int>::min() : numeric_limits<int>::max();
+  }
+  return negative ? -result : result;
+}
+
+Date ParseDate(string_view& sv) {
+  Date result;
+  result.year = ParseInt(sv);
+  sv.remove_prefix(min<size_t>(1, sv.size()));
+  result.month = ParseInt(sv);
+  sv.remove_prefix(min<size_t>(1, sv.size()));
+  result.day = ParseInt(sv);
+  return result;
+}
+
 ostream& operator << (ostream& os, const Date& date) {
   os << setw(4) << setfill('0') << date.year << '-'
      << setw(2) << setfill('0') << date.month << '-'
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <iostream>
+#include <limits>
+#include <string_view>
 
 using namespace std;
 
@@ -18,7 +20,44 @@ bool operator > (const Date& lhs, const Date& rhs);
 bool operator >= (const Date& lhs, const Date& rhs);
 
 Date ParseDate(istream& is);
+// Same as above, but without streams: removes the parsed date from the view
+Date ParseDate(string_view& sv);
+
+// Closed interval [first, last] of dates, empty if last < first.
+// Covers all possible dates by default
+struct DateRange {
+  Date first = {numeric_limits<int>::min(), numeric_limits<int>::min(), numeric_limits<int>::min()};
+  Date last = {numeric_limits<int>::max(), numeric_limits<int>::max(), numeric_limits<int>::max()};
+
+  bool IsEmpty() const {
+    return last < first;
+  }
+};
+
+// Dates present in both ranges
+DateRange Intersect(const DateRange& lhs, const DateRange& rhs);
+// The smallest range containing both ranges
+DateRange Unite(const DateRange& lhs, const DateRange& rhs);
+
+// Dates that DateToKey can pack: ParseDate accepts others as well
+inline bool FitsKey(const Date& date) {
+  return date.year >= 0 && date.year < (1 << 22)
+      && date.month >= 0 && date.month < 16
+      && date.day >= 0 && date.day < 32;
+}
+
+// Packs a date into a single integer; keys compare the same way dates do.
+// day takes 5 bits, month takes 4 bits, the rest is left for the year.
+// The date must fit the key
+inline int DateToKey(const Date& date) {
+  return (date.year << 9) | (date.month << 5) | date.day;
+}
+
+inline Date KeyToDate(int key) {
+  return {key >> 9, (key >> 5) & 0xF, key & 0x1F};
+}
 
 // Tests
 void TestDateOutput();
 void TestParseDate();
+void TestDateRange();
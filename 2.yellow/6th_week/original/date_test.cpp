@@ -29,4 +29,34 @@ void TestParseDate() {
   AssertEqual(date.year, 2017, "Parse date: year");
   AssertEqual(date.month, 11, "Parse date: month");
   AssertEqual(date.day, 15, "Parse date: day");
+
+  string_view sv = " 2017-1-5 event";
+  AssertEqual(ParseDate(sv), Date{2017, 1, 5}, "Parse date: string view");
+  AssertEqual(string(sv), " event", "Parse date: string view keeps the rest");
+
+  sv = "99999999999999999999-2147483647--2147483648 \xff";
+  AssertEqual(ParseDate(sv), Date{numeric_limits<int>::max(), numeric_limits<int>::max(), numeric_limits<int>::min()},
+              "Parse date: numbers out of range");
+  AssertEqual(string(sv), " \xff", "Parse date: out of range numbers are consumed");
+}
+
+void TestDateRange() {
+  const DateRange all;
+  const DateRange january{{2017, 1, 1}, {2017, 1, 31}};
+  const DateRange march{{2017, 3, 1}, {2017, 3, 31}};
+
+  Assert(!all.IsEmpty(), "Date range: default range isn't empty");
+  Assert(all.first < Date{0, 1, 1} && Date{9999, 12, 31} < all.last, "Date range: default range covers all dates");
+
+  Assert(Intersect(january, march).IsEmpty(), "Date range: intersect disjoint");
+  AssertEqual(Intersect(all, january).first, january.first, "Date range: intersect with all 1");
+  AssertEqual(Intersect(all, january).last, january.last, "Date range: intersect with all 2");
+
+  const DateRange first_quarter = Unite(january, march);
+  AssertEqual(first_quarter.first, Date{2017, 1, 1}, "Date range: unite 1");
+  AssertEqual(first_quarter.last, Date{2017, 3, 31}, "Date range: unite 2");
+
+  const DateRange empty = Intersect(january, march);
+  AssertEqual(Unite(empty, march).first, march.first, "Date range: unite with empty 1");
+  AssertEqual(Unite(empty, march).last, march.last, "Date range: unite with empty 2");
 }
@@ -1,10 +1,49 @@
 #include "event_set.h"
 
-void EventSet::Add(const string& event) {
+#include <stdexcept>
+
+namespace {
+
+vector<uint32_t> SortedPositions(const vector<string>& events) {
+  vector<uint32_t> result(events.size());
+  for (size_t i = 0; i < result.size(); ++i) {
+    result[i] = i;
+  }
+  sort(result.begin(), result.end(), [&events](uint32_t lhs, uint32_t rhs) { return events[lhs] < events[rhs]; });
+  return result;
+}
+
+}
+
+EventSet::EventSet(vector<string> events) {
+  const auto sorted = SortedPositions(events);
+  *this = EventSet(move(events), sorted);
+}
+
+EventSet::EventSet(vector<string> events, const vector<uint32_t>& sorted) : event_order_(move(events)) {
+  // every event goes to the end of the set
+  for (const uint32_t position : sorted) {
+    events_.emplace_hint(events_.end(), event_order_.at(position));
+  }
+  if (events_.size() != event_order_.size()) {
+    throw invalid_argument("Repeated event");
+  }
+}
+
+bool EventSet::Add(const string& event) {
   auto insert_result = events_.insert(event);
   if (insert_result.second) {
     event_order_.push_back(event);
   }
+  return insert_result.second;
+}
+
+bool EventSet::Remove(const string& event) {
+  if (events_.erase(event) == 0) {
+    return false;
+  }
+  event_order_.erase(find(event_order_.begin(), event_order_.end(), event));
+  return true;
 }
 
 const vector<string>& EventSet::GetAll() const {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include <string>
 #include <set>
 #include <vector>
@@ -8,15 +9,35 @@ using namespace std;
 
 class EventSet {
  public:
-  void Add(const string& event);
+  EventSet() = default;
+  // The events must be distinct, throws invalid_argument otherwise.
+  // Takes O(N log N) comparisons once instead of a search for every event
+  explicit EventSet(vector<string> events);
+  // The same with positions of the events in the order of strings known,
+  // so that the set is built without comparisons. Other orders give
+  // the same set, only slower
+  EventSet(vector<string> events, const vector<uint32_t>& sorted);
+
+  // returns false if the event is already in the set
+  bool Add(const string& event);
+
+  // returns false if there is no such event in the set
+  bool Remove(const string& event);
 
   const vector<string>& GetAll() const;
 
   template <typename Predicate>
   int Removeif (Predicate predicate) {
+    return Removeif (predicate, [](const string&) {});
+  }
+
+  // on_remove is called for every removed event
+  template <typename Predicate, typename Callback>
+  int Removeif (Predicate predicate, Callback on_remove) {
     auto split_point = stable_partition(event_order_.begin(), event_order_.end(), predicate);
     int result = split_point - event_order_.begin();
     for (auto i = event_order_.begin(); i != split_point; ++i) {
+      on_remove(*i);
       events_.erase(*i);
     }
     event_order_.erase(event_order_.begin(), split_point);
@@ -0,0 +1,268 @@
+#pragma once
+
+#include "date.h"
+#include "event_set.h"
+#include "output_writer.h"
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <string>
+
+using namespace std;
+
+// Entry kept in the database, it is valid until the database is changed
+struct EntryView {
+  const Date& date;
+  const string& event;
+};
+
+ostream& operator << (ostream& os, const EntryView& e);
+OutputWriter& operator << (OutputWriter& out, const EntryView& e);
+
+
+// Goes through the entries of the database matching a predicate,
+// checking them only when it is advanced.
+// Dates come either from the database itself or, if there is a single
+// event to look for, from the dates of this event in the event index
+template <typename Predicate>
+class FindIterator {
+ public:
+  using iterator_category = forward_iterator_tag;
+  using value_type = EntryView;
+  using difference_type = ptrdiff_t;
+  using pointer = void;
+  using reference = EntryView;
+
+  using DateIterator = map<Date, EventSet>::const_iterator;
+  using IndexIterator = set<Date>::const_iterator;
+
+  FindIterator() = default;
+
+  // Scans events of [date, last) skipping ones other than event unless it is nullptr
+  FindIterator(DateIterator date, DateIterator last, const Predicate* predicate, const string* event)
+    : predicate_(predicate)
+    , event_(event)
+    , date_(date)
+    , last_date_(last) {
+    SkipMismatches();
+  }
+
+  // Checks only event on the dates from [date, last)
+  FindIterator(IndexIterator date, IndexIterator last, const Predicate* predicate, const string& event)
+    : predicate_(predicate)
+    , event_(&event)
+    , indexed_(true)
+    , indexed_date_(date)
+    , indexed_last_(last) {
+    SkipMismatches();
+  }
+
+  EntryView operator * () const {
+    if (indexed_) {
+      return {*indexed_date_, *event_};
+    }
+    return {date_->first, date_->second.GetAll()[position_]};
+  }
+
+  FindIterator& operator ++ () {
+    Step();
+    SkipMismatches();
+    return *this;
+  }
+
+  FindIterator operator ++ (int) {
+    FindIterator result = *this;
+    ++*this;
+    return result;
+  }
+
+  bool operator == (const FindIterator& other) const {
+    if (indexed_) {
+      return indexed_date_ == other.indexed_date_;
+    }
+    return date_ == other.date_ && position_ == other.position_;
+  }
+
+  bool operator != (const FindIterator& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  bool AtEnd() const {
+    return indexed_ ? indexed_date_ == indexed_last_ : date_ == last_date_;
+  }
+
+  void Step() {
+    if (indexed_) {
+      ++indexed_date_;
+    } else if (++position_ == date_->second.GetAll().size()) {
+      ++date_;
+      position_ = 0;
+    }
+  }
+
+  void SkipMismatches() {
+    while (!AtEnd()) {
+      const EntryView entry = **this;
+      if ((indexed_ || !event_ || entry.event == *event_) && (*predicate_)(entry.date, entry.event)) {
+        return;
+      }
+      Step();
+    }
+  }
+
+  // belongs to the FindCursor, so that iterators can be assigned
+  const Predicate* predicate_ = nullptr;
+  const string* event_ = nullptr;
+  DateIterator date_{}, last_date_{};
+  // position of the event on the current date
+  size_t position_ = 0;
+  bool indexed_ = false;
+  IndexIterator indexed_date_{}, indexed_last_{};
+};
+
+
+template <typename Iterator>
+class IteratorRange {
+ public:
+  IteratorRange(Iterator begin, Iterator end) : begin_(begin), end_(end) {
+  }
+
+  Iterator begin() const {
+    return begin_;
+  }
+
+  Iterator end() const {
+    return end_;
+  }
+
+ private:
+  Iterator begin_, end_;
+};
+
+// Advances the iterator by at most count, stopping at last
+template <typename Iterator>
+Iterator AdvanceAtMost(Iterator it, Iterator last, size_t count) {
+  for (; count > 0 && it != last; --count) {
+    ++it;
+  }
+  return it;
+}
+
+
+// Pages of page_size elements of a range. Unlike a paginator that stores
+// all pages, the end of a page is found only when the page is reached,
+// so a range is never walked ahead of its reader
+template <typename Iterator>
+class Paginator {
+ public:
+  class PageIterator {
+   public:
+    PageIterator(Iterator begin, Iterator end, size_t page_size)
+      : page_begin_(begin)
+      , page_end_(AdvanceAtMost(begin, end, page_size))
+      , end_(end)
+      , page_size_(page_size) {
+    }
+
+    IteratorRange<Iterator> operator * () const {
+      return {page_begin_, page_end_};
+    }
+
+    PageIterator& operator ++ () {
+      page_begin_ = page_end_;
+      page_end_ = AdvanceAtMost(page_begin_, end_, page_size_);
+      return *this;
+    }
+
+    bool operator != (const PageIterator& other) const {
+      return page_begin_ != other.page_begin_;
+    }
+
+   private:
+    Iterator page_begin_, page_end_, end_;
+    size_t page_size_;
+  };
+
+  Paginator(Iterator begin, Iterator end, size_t page_size)
+    : begin_(begin)
+    , end_(end)
+    , page_size_(max<size_t>(page_size, 1)) {
+  }
+
+  PageIterator begin() const {
+    return {begin_, end_, page_size_};
+  }
+
+  PageIterator end() const {
+    return {end_, end_, page_size_};
+  }
+
+ private:
+  Iterator begin_, end_;
+  size_t page_size_;
+};
+
+template <typename Container>
+auto Paginate(const Container& c, size_t page_size) {
+  return Paginator{c.begin(), c.end(), page_size};
+}
+
+
+// Lazy result of Database::Select. Keeps the predicate, so it must
+// outlive its iterators, and stays valid while the database isn't changed
+template <typename Predicate>
+class FindCursor {
+ public:
+  using Iterator = FindIterator<Predicate>;
+
+  // Matches of a scan over [first, last)
+  FindCursor(Predicate predicate, typename Iterator::DateIterator first,
+             typename Iterator::DateIterator last, const string* event)
+    : predicate_(move(predicate))
+    , begin_(first, last, &predicate_, event)
+    , end_(last, last, &predicate_, event) {
+  }
+
+  // Matches among dates of a single event taken from the index
+  FindCursor(Predicate predicate, typename Iterator::IndexIterator first,
+             typename Iterator::IndexIterator last, const string& event)
+    : predicate_(move(predicate))
+    , begin_(first, last, &predicate_, event)
+    , end_(last, last, &predicate_, event) {
+  }
+
+  // An empty result
+  explicit FindCursor(Predicate predicate) : predicate_(move(predicate)) {
+  }
+
+  // Iterators point to predicate_, so a copy would refer to the original
+  FindCursor(const FindCursor&) = delete;
+  FindCursor& operator = (const FindCursor&) = delete;
+
+  Iterator begin() const {
+    return begin_;
+  }
+
+  Iterator end() const {
+    return end_;
+  }
+
+  // Number of matches, nothing is stored
+  size_t Count() const {
+    return distance(begin_, end_);
+  }
+
+  // limit matches after the first offset ones
+  IteratorRange<Iterator> Page(size_t offset, size_t limit) const {
+    const Iterator first = AdvanceAtMost(begin_, end_, offset);
+    return {first, AdvanceAtMost(first, end_, limit)};
+  }
+
+ private:
+  Predicate predicate_;
+  Iterator begin_, end_;
+};
@@ -1,11 +1,18 @@
+#include "columnar_database.h"
+#include "command_reader.h"
 #include "database.h"
+#include "database_storage.h"
 #include "date.h"
 #include "condition_parser.h"
 #include "node.h"
+#include "output_writer.h"
 #include "test_runner.h"
 
 #include <iostream>
+#include <optional>
 #include <stdexcept>
+#include <thread>
+#include <unistd.h>
 
 using namespace std;
 
@@ -20,54 +27,97 @@ string ParseEvent(istream& is) {
 
 void TestAll();
 
-int main() {
+// Log records after which the database is written into a new snapshot
+const size_t SNAPSHOT_INTERVAL = 10'000'000;
+
+// The database is kept in memory only, unless a path for its files is given.
+// --event-index speeds up conditions on a single event at the cost
+// of a copy of every distinct event:
+//   ./database [--event-index] [path/to/events]
+int main(int argc, char* argv[]) {
   TestAll();
 
   Database db;
+  db.SetThreadCount(thread::hardware_concurrency());
 
-  for (string line; getline(cin, line); ) {
-    istringstream is(line);
-
-    string command;
-    is >> command;
-    if (command == "Add") {
-      const auto date = ParseDate(is);
-      const auto event = ParseEvent(is);
-      db.Add(date, event);
-    } else if (command == "Print") {
-      db.Print(cout);
-    } else if (command == "Del") {
-      auto condition = ParseCondition(is);
-      auto predicate = [condition](const Date& date, const string& event) {
-        return condition->Evaluate(date, event);
-      };
-
-      auto count = db.Removeif (predicate);
-      cout << "Removed " << count << " entries" << endl;
-    } else if (command == "Find") {
-      auto condition = ParseCondition(is);
-      auto predicate = [condition](const Date& date, const string& event) {
-        return condition->Evaluate(date, event);
-      };
-
-
-      const auto entries = db.Findif (predicate);
-      for (const auto& entry : entries) {
-        cout << entry << endl;
-      }
-      cout << "Found " << entries.size() << " entries" << endl;
-    } else if (command == "Last") {
-      try {
-          cout << db.Last(ParseDate(is)) << endl;
-      } catch (invalid_argument&) {
-          cout << "No entries" << endl;
-      }
-    } else if (command.empty()) {
-      continue;
+  optional<DatabaseStorage> storage;
+  for (int i = 1; i < argc; ++i) {
+    if (argv[i] == string_view("--event-index")) {
+      db.EnableEventIndex();
     } else {
-      throw logic_error("Unknown command: " + command);
+      storage.emplace(argv[i]);
     }
   }
+  if (storage) {
+    storage->Load(db);
+  }
+
+  // cout isn't used below, so the output goes around it
+  OutputWriter out(STDOUT_FILENO);
+  try {
+    CommandReader reader(cin);
+    for (string_view line; reader.ReadLine(line); ) {
+      const string_view command = ReadWord(line);
+      if (command == "Add") {
+        const auto date = ParseDate(line);
+        const string event(ParseEvent(line));
+        if (db.Add(date, event) && storage) {
+          storage->LogAdd(date, event);
+          if (storage->GetLogSize() >= SNAPSHOT_INTERVAL) {
+            storage->WriteSnapshot(db);
+          }
+        }
+      } else if (command == "Print") {
+        db.Print(out);
+      } else if (command == "Del") {
+        const auto condition = ParseCondition(line);
+        auto predicate = [&condition](const Date& date, const string& event) {
+          return condition->Evaluate(date, event);
+        };
+
+        vector<Entry> removed;
+        auto count = db.Removeif (predicate, condition->GetDateRange(), condition->GetRequiredEvent(),
+                                  storage ? &removed : nullptr);
+        if (storage) {
+          storage->LogRemove(removed);
+          // the removal is printed only after it is written
+          storage->Flush();
+        }
+        out << "Removed " << count << " entries\n";
+      } else if (command == "Find") {
+        const auto condition = ParseCondition(line);
+        auto predicate = [&condition](const Date& date, const string& event) {
+          return condition->Evaluate(date, event);
+        };
+
+
+        // the dates are scanned by the threads of db, the entries aren't copied
+        const auto entries = db.FindViews(predicate, condition->GetDateRange(), condition->GetRequiredEvent());
+        for (const auto& entry : entries) {
+          out << entry << '\n';
+        }
+        out << "Found " << entries.size() << " entries\n";
+      } else if (command == "Last") {
+        try {
+            out << db.LastView(ParseDate(line)) << '\n';
+        } catch (invalid_argument&) {
+            out << "No entries\n";
+        }
+      } else if (command.empty()) {
+        continue;
+      } else {
+        throw logic_error("Unknown command: " + string(command));
+      }
+    }
+  } catch (exception&) {
+    // shows the output of commands before the failed one
+    out.Flush();
+    throw;
+  }
+
+  if (storage) {
+    storage->WriteSnapshot(db);
+  }
 
   return 0;
 }
@@ -90,14 +140,38 @@ void TestParseEvent() { {
 void TestAll() {
   TestRunner tr;
   tr.RunTest(TestParseEvent, "TestParseEvent");
+  tr.RunTest(TestCommandReader, "TestCommandReader");
+  tr.RunTest(TestReadWord, "TestReadWord");
+  tr.RunTest(TestOutputWriterDate, "TestOutputWriterDate");
+  tr.RunTest(TestOutputWriterBuffer, "TestOutputWriterBuffer");
+  tr.RunTest(TestOutputWriterFileDescriptor, "TestOutputWriterFileDescriptor");
   tr.RunTest(TestDateOutput, "TestDateOutput");
   tr.RunTest(TestParseDate, "TestParseDate");
+  tr.RunTest(TestDateRange, "TestDateRange");
   tr.RunTest(TestDatabaseAddAndPrint, "TestDatabaseAddAndPrint");
   tr.RunTest(TestDatabaseFind, "TestDatabaseFind");
   tr.RunTest(TestDatabaseRemove, "TestDatabaseRemove");
   tr.RunTest(TestDatabaseLast, "TestDatabaseLast");
+  tr.RunTest(TestDatabaseDateRange, "TestDatabaseDateRange");
+  tr.RunTest(TestDatabaseEventIndex, "TestDatabaseEventIndex");
+  tr.RunTest(TestDatabaseThreads, "TestDatabaseThreads");
+  tr.RunTest(TestDatabaseRemovedEntries, "TestDatabaseRemovedEntries");
+  tr.RunTest(TestDatabaseSelect, "TestDatabaseSelect");
+  tr.RunTest(TestDatabaseFindViews, "TestDatabaseFindViews");
+  tr.RunTest(TestDatabaseLastCache, "TestDatabaseLastCache");
+  tr.RunTest(TestDatabaseStorageRestore, "TestDatabaseStorageRestore");
+  tr.RunTest(TestDatabaseStorageSnapshot, "TestDatabaseStorageSnapshot");
+  tr.RunTest(TestDatabaseStorageTruncatedLog, "TestDatabaseStorageTruncatedLog");
+  tr.RunTest(TestColumnarDatabaseAddAndPrint, "TestColumnarDatabaseAddAndPrint");
+  tr.RunTest(TestColumnarDatabaseFind, "TestColumnarDatabaseFind");
+  tr.RunTest(TestColumnarDatabaseRemove, "TestColumnarDatabaseRemove");
+  tr.RunTest(TestColumnarDatabaseLast, "TestColumnarDatabaseLast");
   tr.RunTest(TestDateComparisonNode, "TestDateComparisonNode");
   tr.RunTest(TestEventComparisonNode, "TestEventComparisonNode");
   tr.RunTest(TestLogicalOperationNode, "TestLogicalOperationNode");
+  tr.RunTest(TestNodeDateRange, "TestNodeDateRange");
+  tr.RunTest(TestNodeRequiredEvent, "TestNodeRequiredEvent");
   tr.RunTest(TestParseCondition, "TestParseCondition");
+  tr.RunTest(TestParseConditionDateRange, "TestParseConditionDateRange");
+  tr.RunTest(TestParseConditionFromLine, "TestParseConditionFromLine");
 }
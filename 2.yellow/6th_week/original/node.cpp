@@ -1,5 +1,15 @@
 #include "node.h"
 
+#include <limits>
+
+DateRange Node::GetDateRange() const {
+  return {};
+}
+
+const string* Node::GetRequiredEvent() const {
+  return nullptr;
+}
+
 bool EmptyNode::Evaluate(const Date& date, const string& event) const {
   return true;
 }
@@ -32,6 +42,39 @@ bool DateComparisonNode::Evaluate(const Date& date, const string&) const {
   return CompareTo(date, value_, comparison_);
 }
 
+DateRange DateComparisonNode::GetDateRange() const {
+  // dates are ordered as tuples of ints, so the closest dates
+  // before and after value_ differ from it only in a day.
+  // A day at a limit of int has no such neighbour, then value_ itself
+  // bounds the range, which only makes it a date wider
+  const Date previous = {value_.year, value_.month,
+                         value_.day == numeric_limits<int>::min() ? value_.day : value_.day - 1};
+  const Date next = {value_.year, value_.month,
+                     value_.day == numeric_limits<int>::max() ? value_.day : value_.day + 1};
+
+  DateRange result;
+  switch (comparison_) {
+  case Comparison::Less:
+    result.last = previous;
+    break;
+  case Comparison::LessOrEqual:
+    result.last = value_;
+    break;
+  case Comparison::Equal:
+    result = {value_, value_};
+    break;
+  case Comparison::NotEqual:
+    break;
+  case Comparison::Greater:
+    result.first = next;
+    break;
+  case Comparison::GreaterOrEqual:
+    result.first = value_;
+    break;
+  }
+  return result;
+}
+
 EventComparisonNode::EventComparisonNode(Comparison comparison, const string& value)
   : comparison_(comparison)
   , value_(value) {
@@ -41,6 +84,10 @@ bool EventComparisonNode::Evaluate(const Date&, const string& event) const {
   return CompareTo(event, value_, comparison_);
 }
 
+const string* EventComparisonNode::GetRequiredEvent() const {
+  return comparison_ == Comparison::Equal ? &value_ : nullptr;
+}
+
 LogicalOperationNode::LogicalOperationNode(
     LogicalOperation operation, shared_ptr<Node> left, shared_ptr<Node> right
 )
@@ -58,3 +105,25 @@ bool LogicalOperationNode::Evaluate(const Date& date, const string& event) const
   }
   return false;
 }
+
+DateRange LogicalOperationNode::GetDateRange() const {
+  switch (operation_) {
+  case LogicalOperation::And:
+    return Intersect(left_->GetDateRange(), right_->GetDateRange());
+  case LogicalOperation::Or:
+    return Unite(left_->GetDateRange(), right_->GetDateRange());
+  }
+  return {};
+}
+
+const string* LogicalOperationNode::GetRequiredEvent() const {
+  const string* left = left_->GetRequiredEvent();
+  const string* right = right_->GetRequiredEvent();
+  switch (operation_) {
+  case LogicalOperation::And:
+    return left ? left : right;
+  case LogicalOperation::Or:
+    return left && right && *left == *right ? left : nullptr;
+  }
+  return nullptr;
+}
@@ -8,6 +8,13 @@ using namespace std;
 
 struct Node {
   virtual bool Evaluate(const Date& date, const string& event) const = 0;
+
+  // Dates outside of the range never satisfy the condition.
+  // The range may be wider than necessary, but never narrower
+  virtual DateRange GetDateRange() const;
+
+  // Event every entry satisfying the condition must have, if there is one
+  virtual const string* GetRequiredEvent() const;
 };
 
 
@@ -30,6 +37,7 @@ class DateComparisonNode : public Node {
  public:
   DateComparisonNode(Comparison comparison, const Date& value);
   bool Evaluate(const Date& date, const string& event) const override;
+  DateRange GetDateRange() const override;
 
  private:
   Comparison comparison_;
@@ -41,6 +49,7 @@ class EventComparisonNode : public Node {
  public:
   EventComparisonNode(Comparison comparison, const string& value);
   bool Evaluate(const Date& date, const string& event) const override;
+  const string* GetRequiredEvent() const override;
 
  private:
   Comparison comparison_;
@@ -58,6 +67,8 @@ class LogicalOperationNode : public Node {
  public:
   LogicalOperationNode(LogicalOperation operation, shared_ptr<Node> left, shared_ptr<Node> right);
   bool Evaluate(const Date& date, const string& event) const override;
+  DateRange GetDateRange() const override;
+  const string* GetRequiredEvent() const override;
 
  private:
   LogicalOperation operation_;
@@ -68,3 +79,5 @@ class LogicalOperationNode : public Node {
 void TestDateComparisonNode();
 void TestEventComparisonNode();
 void TestLogicalOperationNode();
+void TestNodeDateRange();
+void TestNodeRequiredEvent();
@@ -1,6 +1,7 @@
 #include "node.h"
 #include "test_runner.h"
 
+#include <limits>
 #include <vector>
 #include <map>
 using namespace std;
@@ -85,3 +86,68 @@ void TestLogicalOperationNode() { {
     Assert(!root.Evaluate({2017, 11, 1}, "Saturday"), "LogicalOperationNode propagates arguments 1");
   }
 }
+
+void TestNodeDateRange() {
+  const Date november_18{2017, 11, 18};
+  const auto before = make_shared<DateComparisonNode>(Comparison::Less, november_18);
+  const auto after = make_shared<DateComparisonNode>(Comparison::GreaterOrEqual, Date{2017, 11, 1});
+  const auto event = make_shared<EventComparisonNode>(Comparison::Equal, "Saturday");
+  {
+    const DateRange range = before->GetDateRange();
+    Assert(range.first < Date{0, 1, 1}, "Node date range: less 1");
+    AssertEqual(range.last, Date{2017, 11, 17}, "Node date range: less 2");
+  } {
+    const DateRange range = DateComparisonNode(Comparison::Greater, november_18).GetDateRange();
+    AssertEqual(range.first, Date{2017, 11, 19}, "Node date range: greater 1");
+    Assert(Date{9999, 12, 31} < range.last, "Node date range: greater 2");
+  } {
+    const DateRange range = DateComparisonNode(Comparison::Equal, november_18).GetDateRange();
+    AssertEqual(range.first, november_18, "Node date range: equal 1");
+    AssertEqual(range.last, november_18, "Node date range: equal 2");
+  } {
+    const DateRange range = DateComparisonNode(Comparison::NotEqual, november_18).GetDateRange();
+    Assert(range.first < Date{0, 1, 1} && Date{9999, 12, 31} < range.last, "Node date range: not equal");
+  } {
+    const DateRange range = LogicalOperationNode(LogicalOperation::And, before, after).GetDateRange();
+    AssertEqual(range.first, Date{2017, 11, 1}, "Node date range: and 1");
+    AssertEqual(range.last, Date{2017, 11, 17}, "Node date range: and 2");
+  } {
+    const DateRange range = LogicalOperationNode(LogicalOperation::And, event, after).GetDateRange();
+    AssertEqual(range.first, Date{2017, 11, 1}, "Node date range: event doesn't restrict and");
+  } {
+    const DateRange range = LogicalOperationNode(LogicalOperation::Or, event, after).GetDateRange();
+    Assert(range.first < Date{0, 1, 1}, "Node date range: event doesn't restrict or");
+  } {
+    // days of dates parsed from huge numbers are at the limits of int
+    const Date min_day{2017, 11, numeric_limits<int>::min()};
+    const Date max_day{2017, 11, numeric_limits<int>::max()};
+    AssertEqual(DateComparisonNode(Comparison::Less, min_day).GetDateRange().last, min_day,
+                "Node date range: less than the least day");
+    AssertEqual(DateComparisonNode(Comparison::Greater, max_day).GetDateRange().first, max_day,
+                "Node date range: greater than the greatest day");
+  } {
+    const DateRange range = EmptyNode().GetDateRange();
+    Assert(range.first < Date{0, 1, 1} && Date{9999, 12, 31} < range.last, "Node date range: empty node");
+  }
+}
+
+void TestNodeRequiredEvent() {
+  const auto holiday = make_shared<EventComparisonNode>(Comparison::Equal, "holiday");
+  const auto workday = make_shared<EventComparisonNode>(Comparison::Equal, "workday");
+  const auto not_holiday = make_shared<EventComparisonNode>(Comparison::NotEqual, "holiday");
+  const auto date = make_shared<DateComparisonNode>(Comparison::Equal, Date{2017, 11, 18});
+
+  AssertEqual(*holiday->GetRequiredEvent(), "holiday", "Node required event: equal");
+  Assert(!not_holiday->GetRequiredEvent(), "Node required event: not equal");
+  Assert(!date->GetRequiredEvent(), "Node required event: date");
+  Assert(!EmptyNode().GetRequiredEvent(), "Node required event: empty node");
+
+  AssertEqual(*LogicalOperationNode(LogicalOperation::And, date, holiday).GetRequiredEvent(), "holiday",
+              "Node required event: and");
+  Assert(!LogicalOperationNode(LogicalOperation::Or, date, holiday).GetRequiredEvent(),
+         "Node required event: or with date");
+  Assert(!LogicalOperationNode(LogicalOperation::Or, workday, holiday).GetRequiredEvent(),
+         "Node required event: or with different events");
+  AssertEqual(*LogicalOperationNode(LogicalOperation::Or, holiday, holiday).GetRequiredEvent(), "holiday",
+              "Node required event: or with the same event");
+}
@@ -0,0 +1,115 @@
+#include "output_writer.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+using namespace std;
+
+namespace {
+
+// Two digits of every number below 100
+const array<char, 200> DIGIT_PAIRS = [] {
+  array<char, 200> result{};
+  for (int i = 0; i < 100; ++i) {
+    result[2 * i] = '0' + i / 10;
+    result[2 * i + 1] = '0' + i % 10;
+  }
+  return result;
+}();
+
+}
+
+OutputWriter::OutputWriter(ostream& os, size_t buffer_size)
+  : os_(&os)
+  , buffer_(max<size_t>(buffer_size, 64))
+  , end_(buffer_.data()) {
+}
+
+OutputWriter::OutputWriter(int fd, size_t buffer_size)
+  : fd_(fd)
+  , buffer_(max<size_t>(buffer_size, 64))
+  , end_(buffer_.data()) {
+}
+
+OutputWriter::~OutputWriter() {
+  try {
+    Flush();
+  } catch (exception&) {
+  }
+}
+
+OutputWriter& OutputWriter::operator << (string_view s) {
+  Reserve(s.size());
+  if (s.size() > buffer_.size()) {
+    WriteOut(s.data(), s.size());
+  } else {
+    end_ = copy(s.begin(), s.end(), end_);
+  }
+  return *this;
+}
+
+OutputWriter& OutputWriter::operator << (char c) {
+  Reserve(1);
+  *end_++ = c;
+  return *this;
+}
+
+OutputWriter& OutputWriter::operator << (const Date& date) {
+  Reserve(3 * (numeric_limits<int>::digits10 + 2));
+  WritePadded(date.year, 4);
+  *end_++ = '-';
+  WritePadded(date.month, 2);
+  *end_++ = '-';
+  WritePadded(date.day, 2);
+  return *this;
+}
+
+void OutputWriter::WritePadded(int value, int width) {
+  if (value >= 0 && value < 100) {
+    if (width == 4) {
+      end_ = fill_n(end_, 2, '0');
+    }
+    end_ = copy_n(&DIGIT_PAIRS[2 * value], 2, end_);
+  } else if (value >= 0 && value < 10'000 && width == 4) {
+    end_ = copy_n(&DIGIT_PAIRS[2 * (value / 100)], 2, end_);
+    end_ = copy_n(&DIGIT_PAIRS[2 * (value % 100)], 2, end_);
+  } else {
+    // negative and long numbers are rare, so they are left to the stream
+    ostringstream os;
+    os << setw(width) << setfill('0') << value;
+    const string s = os.str();
+    end_ = copy(s.begin(), s.end(), end_);
+  }
+}
+
+void OutputWriter::Flush() {
+  const size_t size = end_ - buffer_.data();
+  end_ = buffer_.data();
+  WriteOut(buffer_.data(), size);
+  if (os_) {
+    os_->flush();
+  }
+}
+
+void OutputWriter::WriteOut(const char* data, size_t size) {
+  if (os_) {
+    os_->write(data, size);
+    return;
+  }
+  while (size > 0) {
+    const auto written = write(fd_, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw runtime_error("Can't write to file descriptor " + to_string(fd_) + ": " + strerror(errno));
+    }
+    data += written;
+    size -= written;
+  }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "date.h"
+
+#include <charconv>
+#include <iostream>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+// Collects output in a large buffer and passes it on in big chunks,
+// either to a stream or straight to a file descriptor.
+// Formats the same way as ostream does without any manipulators
+class OutputWriter {
+ public:
+  explicit OutputWriter(ostream& os, size_t buffer_size = 1 << 16);
+  explicit OutputWriter(int fd, size_t buffer_size = 1 << 16);
+  ~OutputWriter();
+
+  OutputWriter(const OutputWriter&) = delete;
+  OutputWriter& operator = (const OutputWriter&) = delete;
+
+  OutputWriter& operator << (string_view s);
+  OutputWriter& operator << (char c);
+  // Same as the operator << for ostream
+  OutputWriter& operator << (const Date& date);
+
+  template <typename Integer, typename = enable_if_t<is_integral_v<Integer>>>
+  OutputWriter& operator << (Integer value) {
+    Reserve(numeric_limits<Integer>::digits10 + 2);
+    end_ = to_chars(end_, buffer_.data() + buffer_.size(), value).ptr;
+    return *this;
+  }
+
+  void Flush();
+
+ private:
+  // Flushes the buffer unless it has room for size more chars
+  void Reserve(size_t size) {
+    if (static_cast<size_t>(buffer_.data() + buffer_.size() - end_) < size) {
+      Flush();
+    }
+  }
+
+  void WritePadded(int value, int width);
+  void WriteOut(const char* data, size_t size);
+
+  ostream* os_ = nullptr;
+  int fd_ = -1;
+  vector<char> buffer_;
+  char* end_;
+};
+
+
+// Tests
+void TestOutputWriterDate();
+void TestOutputWriterBuffer();
+void TestOutputWriterFileDescriptor();
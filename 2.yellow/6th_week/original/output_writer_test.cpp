@@ -0,0 +1,72 @@
+#include "output_writer.h"
+#include "test_runner.h"
+
+#include <cstdio>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+void TestOutputWriterDate() {
+  const vector<Date> dates = {
+    {2017, 11, 15}, {2017, 1, 1}, {2, 10, 10}, {0, 1, 1}, {999, 9, 9}, {9999, 12, 31},
+    {10000, 1, 1}, {123456, 0, 0}, {-1, 1, 1}, {-2017, -1, -31}, {2017, 100, 123},
+    {numeric_limits<int>::min(), numeric_limits<int>::max(), 0},
+  };
+  for (const Date& date : dates) {
+    ostringstream expected;
+    expected << date;
+    ostringstream os;
+    {
+      OutputWriter out(os);
+      out << date;
+    }
+    AssertEqual(os.str(), expected.str(), "Output writer: date " + expected.str());
+  }
+}
+
+void TestOutputWriterBuffer() { {
+    ostringstream os;
+    OutputWriter out(os, 64);
+    out << "Found " << 2 << " entries" << '\n';
+    AssertEqual(os.str(), "", "Output writer: output is buffered");
+    out.Flush();
+    AssertEqual(os.str(), "Found 2 entries\n", "Output writer: flush");
+  } {
+    ostringstream expected;
+    ostringstream os;
+    {
+      OutputWriter out(os, 64);
+      for (int i = 0; i < 1000; ++i) {
+        const string event(i % 150, 'a' + i % 26);
+        expected << Date{2017, 1 + i % 12, 1 + i % 31} << ' ' << event << ' ' << -i << ' ' << 1ull << 63 << '\n';
+        out << Date{2017, 1 + i % 12, 1 + i % 31} << ' ' << event << ' ' << -i << ' ' << 1ull << 63 << '\n';
+      }
+    }
+    AssertEqual(os.str(), expected.str(), "Output writer: strings longer than the buffer");
+  }
+}
+
+void TestOutputWriterFileDescriptor() {
+  FILE* file = tmpfile();
+  Assert(file != nullptr, "Output writer: temporary file");
+  {
+    OutputWriter out(fileno(file), 64);
+    for (int i = 0; i < 100; ++i) {
+      out << Date{2017, 11, i % 30 + 1} << " event " << i << '\n';
+    }
+  }
+  rewind(file);
+  string written;
+  for (int c; (c = fgetc(file)) != EOF; ) {
+    written += static_cast<char>(c);
+  }
+  fclose(file);
+
+  ostringstream expected;
+  for (int i = 0; i < 100; ++i) {
+    expected << Date{2017, 11, i % 30 + 1} << " event " << i << '\n';
+  }
+  AssertEqual(written, expected.str(), "Output writer: file descriptor");
+}
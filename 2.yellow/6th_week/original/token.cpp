@@ -9,7 +9,7 @@ vector<Token> Tokenize(istream& cl) {
 
   char c;
   while (cl >> c) {
-    if (isdigit(c)) {
+    if (isdigit(static_cast<unsigned char>(c))) {
       string date(1, c);
       for (int i = 0; i < 3; ++i) {
         while (isdigit(cl.peek())) {
@@ -84,3 +84,88 @@ vector<Token> Tokenize(istream& cl) {
 
   return tokens;
 }
+
+// Removes the keyword from the line if it starts with it
+bool SkipKeyword(string_view& cl, string_view keyword) {
+  if (cl.substr(0, keyword.size()) != keyword) {
+    return false;
+  }
+  cl.remove_prefix(keyword.size());
+  return true;
+}
+
+vector<TokenView> Tokenize(string_view cl) {
+  vector<TokenView> tokens;
+
+  while (!cl.empty()) {
+    if (isspace(static_cast<unsigned char>(cl.front()))) {
+      cl.remove_prefix(1);
+      continue;
+    }
+    const char* token_begin = cl.data();
+    const char c = cl.front();
+    cl.remove_prefix(1);
+
+    if (isdigit(static_cast<unsigned char>(c))) {
+      for (int i = 0; i < 3; ++i) {
+        while (!cl.empty() && isdigit(static_cast<unsigned char>(cl.front()))) {
+          cl.remove_prefix(1);
+        }
+        if (i < 2 && !cl.empty()) {
+          cl.remove_prefix(1); // Consume '-'
+        }
+      }
+      tokens.push_back({{token_begin, static_cast<size_t>(cl.data() - token_begin)}, TokenType::DATE});
+    } else if (c == '"') {
+      const size_t end = cl.find('"');
+      tokens.push_back({cl.substr(0, end), TokenType::EVENT});
+      cl.remove_prefix(end == string_view::npos ? cl.size() : end + 1);
+    } else if (c == 'd') {
+      if (SkipKeyword(cl, "ate")) {
+        tokens.push_back({"date", TokenType::COLUMN});
+      } else {
+        throw logic_error("Unknown token");
+      }
+    } else if (c == 'e') {
+      if (SkipKeyword(cl, "vent")) {
+        tokens.push_back({"event", TokenType::COLUMN});
+      } else {
+        throw logic_error("Unknown token");
+      }
+    } else if (c == 'A') {
+      if (SkipKeyword(cl, "ND")) {
+        tokens.push_back({"AND", TokenType::LOGICAL_OP});
+      } else {
+        throw logic_error("Unknown token");
+      }
+    } else if (c == 'O') {
+      if (SkipKeyword(cl, "R")) {
+        tokens.push_back({"OR", TokenType::LOGICAL_OP});
+      } else {
+        throw logic_error("Unknown token");
+      }
+    } else if (c == '(') {
+      tokens.push_back({"(", TokenType::PAREN_LEFT});
+    } else if (c == ')') {
+      tokens.push_back({")", TokenType::PAREN_RIGHT});
+    } else if (c == '<') {
+      tokens.push_back({SkipKeyword(cl, "=") ? "<=" : "<", TokenType::COMPARE_OP});
+    } else if (c == '>') {
+      tokens.push_back({SkipKeyword(cl, "=") ? ">=" : ">", TokenType::COMPARE_OP});
+    } else if (c == '=') {
+      if (SkipKeyword(cl, "=")) {
+        tokens.push_back({"==", TokenType::COMPARE_OP});
+      } else {
+        throw logic_error("Unknown token");
+      }
+    } else if (c == '!') {
+      if (SkipKeyword(cl, "=")) {
+        tokens.push_back({"!=", TokenType::COMPARE_OP});
+      } else {
+        throw logic_error("Unknown token");
+      }
+    }
+  }
+
+  return tokens;
+}
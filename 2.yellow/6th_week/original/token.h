@@ -1,6 +1,7 @@
 #pragma once
 
 #include <sstream>
+#include <string_view>
 #include <vector>
 using namespace std;
 
@@ -21,4 +22,13 @@ struct Token {
 };
 
 
+// Token pointing into the tokenized line instead of owning its value
+struct TokenView {
+  string_view value;
+  TokenType type;
+};
+
+
 vector<Token> Tokenize(istream& cl);
+// Splits the line the same way as above without copying token values
+vector<TokenView> Tokenize(string_view cl);
@@ -1,9 +1,13 @@
 #include <iomanip>
 #include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
 #include <vector>
 #include <utility>
 
 #include "profile.h"
+#include "reading_manager.h"
 #include "test_runner.h"
 #include <random>
 
@@ -47,6 +51,7 @@ class ReadingManager {
     vector<int> lagging_people;
 };
 
+template <typename ReadingManager>
 void TestReadPage() {
     {
         ReadingManager m;
@@ -238,31 +243,105 @@ void TestReadPage() {
     }
 }
 
-void TestSpeed() {
-    // Q < 10^6
-    // ID < 10^5
-    // page_num < 10^3
+void TestPageRange() {
+    FenwickReadingManager manager(1'000'000);
+    manager.Read(1, 1'000'000);
+    manager.Read(2, 999'999);
+    manager.Read(3, 0);
+    ASSERT_EQUAL(manager.Cheer(1), 1.0);
+    ASSERT_EQUAL(manager.Cheer(2), 0.5);
+    ASSERT_EQUAL(manager.Cheer(3), 0.0);
+    manager.Read(3, 1'000'000);
+    ASSERT_EQUAL(manager.Cheer(1), 0.5);
+    ASSERT_EQUAL(manager.Cheer(3), 0.5);
+
+    manager.Read(50'000'000, 10);
+    ASSERT_EQUAL(manager.Cheer(50'000'000), 0.0);
+    ASSERT_EQUAL(manager.Cheer(2), 1.0 / 3.0);
+    ASSERT_EQUAL(manager.Cheer(49'999'999), 0.0);
+
+    try {
+        manager.Read(4, 1'000'001);
+        ASSERT(false);
+    } catch (out_of_range&) {
+    }
+}
+
+void TestMatchesReadingManager() {
     mt19937 gen;
-    uniform_int_distribution<> id(0, 100'000);
-    uniform_int_distribution<> num(0, 1000);
-    {
-        ReadingManager r;
-        {
-            LOG_DURATION("Read");
+    uniform_int_distribution<> id(0, 1'000);
+    uniform_int_distribution<> step(0, 50);
+    ReadingManager expected;
+    FenwickReadingManager manager;
+    // pages of a user only grow in the original task
+    vector<int> pages(1'001, 0);
+    for (int q = 0; q < 100'000; ++q) {
+        const int user = id(gen);
+        if (q % 2 == 0) {
+            pages[user] = min(pages[user] + step(gen), 1'000);
+            expected.Read(user, pages[user]);
+            manager.Read(user, pages[user]);
+        } else {
+            ASSERT_EQUAL(manager.Cheer(user), expected.Cheer(user));
+        }
+    }
+}
 
-            for (size_t q = 0; q < 100'000; ++q) {
-                auto a = id(gen);
-                auto b = num(gen);
-                r.Read(a, b);
-            }
+void TestScatteredUserIds() {
+    mt19937 gen;
+    uniform_int_distribution<> id(0, 1'000);
+    uniform_int_distribution<> step(0, 50);
+    ReadingManager expected;
+    FenwickReadingManager manager;
+    vector<int> pages(1'001, 0);
+    for (int q = 0; q < 100'000; ++q) {
+        const int user = id(gen);
+        // small ids are first kept apart and then moved into the array
+        const int user_id = user % 3 == 0 ? user * 3 : user * 100'003;
+        if (q % 2 == 0) {
+            pages[user] = min(pages[user] + step(gen), 1'000);
+            expected.Read(user_id, pages[user]);
+            manager.Read(user_id, pages[user]);
+        } else {
+            ASSERT_EQUAL(manager.Cheer(user_id), expected.Cheer(user_id));
+        }
+    }
+}
+
+template <typename ReadingManager>
+void MeasureReadingManager(const string& name, ReadingManager& manager, int max_page_count, int max_user_count) {
+    mt19937 gen;
+    uniform_int_distribution<> id(0, max_user_count - 1);
+    uniform_int_distribution<> num(0, max_page_count);
+    const string sizes = name + " with " + to_string(max_page_count) + " pages and "
+        + to_string(max_user_count) + " users: ";
+    {
+        LOG_DURATION(sizes + "1M Read");
+        for (size_t q = 0; q < 1'000'000; ++q) {
+            auto a = id(gen);
+            auto b = num(gen);
+            manager.Read(a, b);
+        }
+    }
+    {
+        LOG_DURATION(sizes + "1M Cheer");
+        for (size_t q = 0; q < 1'000'000; ++q) {
+            auto c = id(gen);
+            manager.Cheer(c);
         }
-        {
-            LOG_DURATION("Cheer");
+    }
+}
 
-            for (size_t q = 0; q < 1'000'000; ++q) {
-                auto c = id(gen);
-                r.Cheer(c);
-            }
+void TestSpeed() {
+    // the original limits: Q < 10^6, ID < 10^5, page_num < 10^3
+    {
+        ReadingManager r;
+        MeasureReadingManager("ReadingManager", r, 1'000, 100'000);
+    }
+    for (int max_page_count : {1'000, 100'000, 1'000'000}) {
+        for (int max_user_count : {100'000, 10'000'000}) {
+            FenwickReadingManager r(max_page_count);
+            MeasureReadingManager("FenwickReadingManager", r, max_page_count, max_user_count);
         }
     }
 }
@@ -274,7 +353,15 @@ int main() {
     ios::sync_with_stdio(false);
     cin.tie(nullptr);
 
-    ReadingManager manager;
+    // TestRunner tr;
+    // RUN_TEST(tr, TestReadPage<ReadingManager>);
+    // RUN_TEST(tr, TestReadPage<FenwickReadingManager>);
+    // RUN_TEST(tr, TestPageRange);
+    // RUN_TEST(tr, TestMatchesReadingManager);
+    // RUN_TEST(tr, TestScatteredUserIds);
+    // RUN_TEST(tr, TestSpeed);
+
+    FenwickReadingManager manager;
     int query_count;
     cin >> query_count;
 
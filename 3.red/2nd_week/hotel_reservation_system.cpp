@@ -1,12 +1,20 @@
 #include <iomanip>
 #include <iostream>
 #include <vector>
-#include <queue>
 #include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <sstream>
 
 #include "profile.h"
+#include "sliding_window.h"
 #include "test_runner.h"
 
 using namespace std;
@@ -17,63 +25,178 @@ using namespace std;
 // client_id 10^9
 // room_count 10^3
 
+// Hotel name of up to 16 bytes packed into two words and padded with zeros,
+// so that names are compared and hashed as a pair of integers
+struct InlineName {
+    static constexpr size_t CAPACITY = 2 * sizeof(uint64_t);
+
+    explicit InlineName(string_view name) {
+        memcpy(words, name.data(), name.size());
+    }
+
+    bool operator==(const InlineName& other) const {
+        return words[0] == other.words[0] && words[1] == other.words[1];
+    }
+
+    uint64_t words[2] = {0, 0};
+};
+
+struct InlineNameHasher {
+    size_t operator()(const InlineName& name) const {
+        uint64_t hash = (name.words[0] * 0x9E3779B97F4A7C15ull) ^ name.words[1];
+        hash *= 0xBF58476D1CE4E5B9ull;
+        return hash ^ (hash >> 31);
+    }
+};
+
+// Dense ids of hotel names. Released ids are given to new names first,
+// so ids stay below the largest number of names interned at once
+class HotelIds {
+ public:
+    static constexpr size_t NOT_FOUND = numeric_limits<size_t>::max();
+
+    size_t Intern(string_view name) {
+        const size_t id = free_ids.empty() ? names.size() : free_ids.back();
+        const bool inserted = name.size() <= InlineName::CAPACITY
+            ? short_ids.try_emplace(InlineName(name), id).second
+            : long_ids.try_emplace(string(name), id).second;
+        if (!inserted) {
+            return Find(name);
+        }
+        if (free_ids.empty()) {
+            names.emplace_back(name);
+        } else {
+            free_ids.pop_back();
+            names[id] = name;
+        }
+        return id;
+    }
+
+    // Forgets the name of the id, which goes to a name interned later
+    void Release(size_t id) {
+        const string& name = names[id];
+        if (name.size() <= InlineName::CAPACITY) {
+            short_ids.erase(InlineName(name));
+        } else {
+            long_ids.erase(name);
+        }
+        free_ids.push_back(id);
+    }
+
+    size_t Find(string_view name) const {
+        if (name.size() <= InlineName::CAPACITY) {
+            const auto it = short_ids.find(InlineName(name));
+            return it == short_ids.end() ? NOT_FOUND : it->second;
+        }
+        const auto it = long_ids.find(string(name));
+        return it == long_ids.end() ? NOT_FOUND : it->second;
+    }
+
+    size_t GetCount() const {
+        return short_ids.size() + long_ids.size();
+    }
+
+ private:
+    unordered_map<InlineName, size_t, InlineNameHasher> short_ids;
+    // names longer than the problem allows
+    unordered_map<string, size_t> long_ids;
+    // name of every id, released ones included
+    vector<string> names;
+    vector<size_t> free_ids;
+};
+
 class BookingManager {
  public:
-    void Book(int64_t time, const string& hotel_name, size_t client_id, uint16_t room_count) {
-        last_time = time;
-        auto& current_hotel   = hotels[hotel_name];
-        UpdateHotel(hotel_name);
-        current_hotel.clients.insert(client_id);
-        current_hotel.rooms += room_count;
-        current_hotel.reservations.push({time, client_id, room_count});
+    static const int64_t ONE_DAY = 86400;
+
+    explicit BookingManager(int64_t window_length = ONE_DAY)
+        : bookings(window_length) {}
+
+    // Hotels left without bookings are forgotten before the hotel is interned,
+    // so that it may get one of their ids
+    void Book(int64_t time, string_view hotel_name, size_t client_id, uint16_t room_count) {
+        bookings.Expire(time, [this](size_t id) { hotel_ids.Release(id); });
+        bookings.Add(time, hotel_ids.Intern(hotel_name), client_id, room_count);
     }
 
-    size_t Clients(const string& hotel_name) {
-        UpdateHotel(hotel_name);
-        return hotels[hotel_name].clients.size();
+    // Unknown hotels aren't interned, their id is past the end of the counters
+    size_t Clients(string_view hotel_name) const {
+        return bookings.CountClients(hotel_ids.Find(hotel_name));
+    }
+    size_t Rooms(string_view hotel_name) const {
+        return bookings.GetSum(hotel_ids.Find(hotel_name));
     }
-    size_t Rooms(const string& hotel_name) {
-        UpdateHotel(hotel_name);
-        return hotels[hotel_name].rooms;
+
+    size_t GetHotelCount() const {
+        return bookings.GetKeyCount();
+    }
+
+    size_t GetKnownNameCount() const {
+        return hotel_ids.GetCount();
     }
 
  private:
-    struct Reservation {
-        Reservation(int64_t _time, size_t _client_id, uint16_t _room_count)
-            : time(_time), client_id(_client_id), room_count(_room_count) {}
-
-        const int64_t  time;
-        const size_t   client_id;
-        const uint16_t room_count;
-    };
-
-
-    struct Data {
-        size_t               rooms = 0;
-        set<size_t>           clients;
-        queue<Reservation> reservations;
-    };
-
-
-    void UpdateHotel(const string& hotel_name) {
-        auto& current_hotel = hotels[hotel_name];
-        while (!current_hotel.reservations.empty() &&
-               !IsLastDay(current_hotel.reservations.front().time)) {
-            current_hotel.rooms -= current_hotel.reservations.front().room_count;
-            current_hotel.clients.erase(current_hotel.reservations.front().client_id);
-            current_hotel.reservations.pop();
-        }
+    HotelIds hotel_ids;
+    SlidingWindowCounters bookings;
+};
+
+// Splits the input into words without copying them
+class WordReader {
+ public:
+    explicit WordReader(string_view input) : input(input) {}
+
+    string_view Next() {
+        input.remove_prefix(min(input.find_first_not_of(SPACES), input.size()));
+        const string_view word = input.substr(0, input.find_first_of(SPACES));
+        input.remove_prefix(word.size());
+        return word;
     }
-    bool IsLastDay(int64_t another) {
-        return (last_time - ONE_DAY < another) && (another <= last_time);
+
+    template <typename Number>
+    Number NextNumber() {
+        const string_view word = Next();
+        Number result = 0;
+        from_chars(word.data(), word.data() + word.size(), result);
+        return result;
     }
-    static const int64_t ONE_DAY = 86400;
 
  private:
-    map<string, Data> hotels;
-    int64_t last_time = 0;
+    static constexpr string_view SPACES = " \t\r\n";
+
+    string_view input;
 };
 
+string ReadAll(istream& input) {
+    string result;
+    char buffer[1 << 16];
+    while (input.read(buffer, sizeof(buffer)) || input.gcount() > 0) {
+        result.append(buffer, input.gcount());
+    }
+    return result;
+}
+
+void ProcessQueries(string_view input, ostream& output) {
+    BookingManager manager;
+    WordReader reader(input);
+
+    const int query_count = reader.NextNumber<int>();
+    for (int query_id = 0; query_id < query_count; ++query_id) {
+        const string_view query_type = reader.Next();
+
+        if (query_type == "BOOK") {
+            const int64_t time = reader.NextNumber<int64_t>();
+            const string_view hotel_name = reader.Next();
+            const size_t client_id = reader.NextNumber<size_t>();
+            const uint16_t room_count = reader.NextNumber<uint16_t>();
+            manager.Book(time, hotel_name, client_id, room_count);
+        } else if (query_type == "CLIENTS") {
+            output << manager.Clients(reader.Next()) << '\n';
+        } else if (query_type == "ROOMS") {
+            output << manager.Rooms(reader.Next()) << '\n';
+        }
+    }
+}
+
 void TestCoursera() {
     {
         BookingManager manager;
@@ -105,42 +228,221 @@ void TestCoursera() {
         ASSERT_EQUAL(b.Clients("a"), 1);
         ASSERT_EQUAL(b.Rooms("a"), 1);
     }
+    // a client with two bookings in the window
+    {
+        BookingManager b;
+        b.Book(0, "a", 1, 1);
+        b.Book(10, "a", 1, 2);
+        b.Book(86400, "a", 2, 3);
+        ASSERT_EQUAL(b.Clients("a"), 2u);
+        ASSERT_EQUAL(b.Rooms("a"), 5u);
+        b.Book(86410, "b", 3, 1);
+        ASSERT_EQUAL(b.Clients("a"), 1u);
+        ASSERT_EQUAL(b.Rooms("a"), 3u);
+    }
 }
 
-int main() {
-    ios::sync_with_stdio(false);
-    cin.tie(nullptr);
+void TestWindowLength() {
+    BookingManager b(10);
+    b.Book(-5, "a", 1, 1);
+    b.Book(0, "b", 1, 2);
+    ASSERT_EQUAL(b.Rooms("a"), 1u);
+    b.Book(5, "b", 2, 3);
+    ASSERT_EQUAL(b.Rooms("a"), 0u);
+    ASSERT_EQUAL(b.Clients("a"), 0u);
+    ASSERT_EQUAL(b.Clients("b"), 2u);
+    b.Book(10, "b", 2, 4);
+    ASSERT_EQUAL(b.Clients("b"), 1u);
+    ASSERT_EQUAL(b.Rooms("b"), 7u);
+    ASSERT_EQUAL(b.Clients("c"), 0u);
+}
 
-    // TestRunner t;
-    // RUN_TEST(t, TestCoursera);
+void TestExpiredHotelsAreForgotten() {
+    BookingManager b(10);
+    b.Book(0, "a", 1, 1);
+    b.Book(1, "b", 1, 1);
+    b.Book(2, "b", 2, 1);
+    ASSERT_EQUAL(b.GetHotelCount(), 2u);
+    // queries don't add hotels
+    ASSERT_EQUAL(b.Clients("c"), 0u);
+    ASSERT_EQUAL(b.Rooms("d"), 0u);
+    ASSERT_EQUAL(b.GetHotelCount(), 2u);
 
-    BookingManager manager;
+    // nobody asks about "a", but its bookings expire anyway
+    b.Book(11, "b", 3, 1);
+    ASSERT_EQUAL(b.GetHotelCount(), 1u);
+    b.Book(100, "c", 1, 1);
+    ASSERT_EQUAL(b.GetHotelCount(), 1u);
+    ASSERT_EQUAL(b.Clients("b"), 0u);
+    ASSERT_EQUAL(b.Rooms("c"), 1u);
 
-    int query_count;
-    cin >> query_count;
+    ASSERT_EQUAL(b.GetKnownNameCount(), 1u);
 
-    for (int query_id = 0; query_id < query_count; ++query_id) {
-        string query_type;
-        cin >> query_type;
+    // memory is bounded by the window, not by the number of hotels ever booked
+    for (int i = 0; i < 1'000; ++i) {
+        b.Book(1'000 + i, "hotel" + to_string(i), i, 1);
+        ASSERT(b.GetHotelCount() <= 10u);
+        ASSERT(b.GetKnownNameCount() <= 10u);
+    }
+    ASSERT_EQUAL(b.GetKnownNameCount(), 10u);
+    ASSERT_EQUAL(b.Clients("hotel0"), 0u);
+    ASSERT_EQUAL(b.Clients("hotel999"), 1u);
+    // a forgotten hotel is booked again after all the others expire
+    b.Book(3'000, "hotel0", 1, 5);
+    ASSERT_EQUAL(b.Rooms("hotel0"), 5u);
+    ASSERT_EQUAL(b.Clients("hotel999"), 0u);
+    ASSERT_EQUAL(b.GetKnownNameCount(), 1u);
+}
 
-        if (query_type == "BOOK") {
-            int64_t time;
-            string hotel_name;
-            size_t client_id;
-            uint16_t room_count;
+void TestHotelIds() {
+    HotelIds ids;
+    ASSERT_EQUAL(ids.Find("Marriott"), HotelIds::NOT_FOUND);
+    ASSERT_EQUAL(ids.Intern("Marriott"), 0u);
+    ASSERT_EQUAL(ids.Intern("FourSeasons"), 1u);
+    ASSERT_EQUAL(ids.Intern("Marriott"), 0u);
+    ASSERT_EQUAL(ids.Find("FourSeasons"), 1u);
+    ASSERT_EQUAL(ids.Find("Marriot"), HotelIds::NOT_FOUND);
+    ASSERT_EQUAL(ids.Find("Marriottt"), HotelIds::NOT_FOUND);
 
-            cin >> time >> hotel_name >> client_id >> room_count;
-            manager.Book(time, hotel_name, client_id, room_count);
-        } else if (query_type == "CLIENTS") {
-            string hotel_name;
-            cin >> hotel_name;
-            cout << manager.Clients(hotel_name) << "\n";
-        } else if (query_type == "ROOMS") {
-            string hotel_name;
-            cin >> hotel_name;
-            cout << manager.Rooms(hotel_name) << '\n';
+    // names differing in the last byte of each word
+    ASSERT_EQUAL(ids.Intern("aaaaaaab"), 2u);
+    ASSERT_EQUAL(ids.Intern("aaaaaaac"), 3u);
+    ASSERT_EQUAL(ids.Intern("aaaaaaaaaaaaaaab"), 4u);
+    ASSERT_EQUAL(ids.Intern("aaaaaaaaaaaaaaac"), 5u);
+    // too long to be inline
+    ASSERT_EQUAL(ids.Intern("aaaaaaaaaaaaaaaab"), 6u);
+    ASSERT_EQUAL(ids.Intern("aaaaaaaaaaaaaaaab"), 6u);
+    ASSERT_EQUAL(ids.Find("aaaaaaaaaaaaaaaab"), 6u);
+    ASSERT_EQUAL(ids.Find("aaaaaaaaaaaaaaaac"), HotelIds::NOT_FOUND);
+    ASSERT_EQUAL(ids.GetCount(), 7u);
+
+    // released ids go to new names, the latest released first
+    ids.Release(1);
+    ids.Release(6);
+    ASSERT_EQUAL(ids.GetCount(), 5u);
+    ASSERT_EQUAL(ids.Find("FourSeasons"), HotelIds::NOT_FOUND);
+    ASSERT_EQUAL(ids.Find("aaaaaaaaaaaaaaaab"), HotelIds::NOT_FOUND);
+    ASSERT_EQUAL(ids.Intern("Hilton"), 6u);
+    ASSERT_EQUAL(ids.Intern("FourSeasons"), 1u);
+    ASSERT_EQUAL(ids.Intern("Hilton"), 6u);
+    ASSERT_EQUAL(ids.Intern("Radisson"), 7u);
+    ASSERT_EQUAL(ids.GetCount(), 8u);
+}
+
+void TestProcessQueries() {
+    const string input =
+        "11\n"
+        "CLIENTS Marriott\n"
+        "ROOMS Marriott\n"
+        "BOOK 10 FourSeasons 1 2\n"
+        "BOOK 10 Marriott 1 1\n"
+        "BOOK 86409 FourSeasons 2 1\n"
+        "CLIENTS FourSeasons\n"
+        "ROOMS FourSeasons\n"
+        "CLIENTS Marriott\n"
+        "BOOK 86410 Marriott 2 10\n"
+        "ROOMS FourSeasons\n"
+        "ROOMS Marriott\n";
+    ostringstream output;
+    ProcessQueries(input, output);
+    ASSERT_EQUAL(output.str(), "0\n0\n2\n3\n1\n1\n10\n");
+
+    ostringstream negative;
+    ProcessQueries("3 BOOK -1000000000000000000 a 1000000000 1000 "
+                   "CLIENTS a ROOMS a", negative);
+    ASSERT_EQUAL(negative.str(), "1\n1000\n");
+}
+
+struct Booking {
+    int64_t time;
+    string hotel_name;
+    size_t client_id;
+    uint16_t room_count;
+};
+
+vector<Booking> GenerateBookings(size_t count, int hotel_count, int client_count, int64_t max_step) {
+    mt19937 gen;
+    uniform_int_distribution<> hotel(0, hotel_count - 1);
+    uniform_int_distribution<> client(0, client_count - 1);
+    uniform_int_distribution<> rooms(1, 1'000);
+    uniform_int_distribution<int64_t> step(0, max_step);
+    vector<Booking> result;
+    int64_t time = -1'000'000'000'000'000'000;
+    for (size_t i = 0; i < count; ++i) {
+        time += step(gen);
+        result.push_back({time, "hotel" + to_string(hotel(gen)), static_cast<size_t>(client(gen)),
+                          static_cast<uint16_t>(rooms(gen))});
+    }
+    return result;
+}
+
+void TestMatchesBruteForce() {
+    const int64_t window = 1'000;
+    const auto bookings = GenerateBookings(3'000, 5, 20, 50);
+    BookingManager manager(window);
+    for (size_t i = 0; i < bookings.size(); ++i) {
+        manager.Book(bookings[i].time, bookings[i].hotel_name, bookings[i].client_id, bookings[i].room_count);
+
+        const string& hotel_name = bookings[i].hotel_name;
+        set<size_t> clients;
+        size_t rooms = 0;
+        for (size_t j = 0; j <= i; ++j) {
+            if (bookings[j].hotel_name == hotel_name && bookings[j].time > bookings[i].time - window) {
+                clients.insert(bookings[j].client_id);
+                rooms += bookings[j].room_count;
+            }
+        }
+        ASSERT_EQUAL(manager.Clients(hotel_name), clients.size());
+        ASSERT_EQUAL(manager.Rooms(hotel_name), rooms);
+    }
+}
+
+void TestSpeed() {
+    // 10^6 queries: a booking and a query of every kind per three queries
+    const auto bookings = GenerateBookings(333'334, 1'000, 100'000, 1'000);
+    BookingManager manager;
+    size_t total = 0;
+    {
+        LOG_DURATION("10^6 queries");
+        for (const auto& booking : bookings) {
+            manager.Book(booking.time, booking.hotel_name, booking.client_id, booking.room_count);
+            total += manager.Clients(booking.hotel_name) + manager.Rooms(booking.hotel_name);
         }
     }
+    ASSERT(total > 0);
+
+    ostringstream input;
+    input << 3 * bookings.size() << '\n';
+    for (const auto& booking : bookings) {
+        input << "BOOK " << booking.time << ' ' << booking.hotel_name << ' '
+              << booking.client_id << ' ' << booking.room_count << '\n'
+              << "CLIENTS " << booking.hotel_name << '\n'
+              << "ROOMS " << booking.hotel_name << '\n';
+    }
+    const string text = input.str();
+    ostringstream output;
+    {
+        LOG_DURATION("10^6 queries from text");
+        ProcessQueries(text, output);
+    }
+    ASSERT(!output.str().empty());
+}
+
+int main() {
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
+
+    // TestRunner t;
+    // RUN_TEST(t, TestCoursera);
+    // RUN_TEST(t, TestWindowLength);
+    // RUN_TEST(t, TestExpiredHotelsAreForgotten);
+    // RUN_TEST(t, TestHotelIds);
+    // RUN_TEST(t, TestProcessQueries);
+    // RUN_TEST(t, TestMatchesBruteForce);
+    // RUN_TEST(t, TestSpeed);
+
+    const string input = ReadAll(cin);
+    ProcessQueries(input, cout);
 
     return 0;
 }
@@ -0,0 +1,320 @@
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "profile.h"
+#include "reading_manager.h"
+#include "test_runner.h"
+
+using namespace std;
+
+struct Query {
+    enum class Type { Read, Cheer };
+
+    Type type;
+    int book;
+    int user;
+    int page = 0;
+};
+
+// Reading progress of many books at once. Books are split between shards,
+// every shard has its own worker thread, queue and books, so queries
+// to books of different shards don't share anything
+class LibraryManager {
+ public:
+    explicit LibraryManager(size_t shard_count, int max_page_count = 1'000)
+        : max_page_count_(max_page_count)
+        , shards_(max<size_t>(shard_count, 1)) {
+        for (auto& shard : shards_) {
+            shard.worker = thread([this, &shard] { Work(shard); });
+        }
+    }
+
+    ~LibraryManager() {
+        for (auto& shard : shards_) {
+            {
+                lock_guard<mutex> lock(shard.m);
+                shard.stopped = true;
+            }
+            shard.cv.notify_one();
+            shard.worker.join();
+        }
+    }
+
+    // Returns results of the Cheer queries in the order of queries.
+    // Queries to the same book are run in their order.
+    // If a query throws, the first exception is rethrown once all shards
+    // are done with the batch: queries of other shards are run anyway,
+    // queries of the same shard after the failed one are not.
+    // Nothing is rolled back, so the books keep the queries that were run
+    vector<double> Process(const vector<Query>& queries) {
+        vector<vector<size_t>> shard_queries(shards_.size());
+        for (size_t i = 0; i < queries.size(); ++i) {
+            shard_queries[queries[i].book % shards_.size()].push_back(i);
+        }
+
+        vector<double> results(queries.size());
+        vector<future<void>> done;
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            if (shard_queries[i].empty()) {
+                continue;
+            }
+            Task task{&queries, move(shard_queries[i]), &results, {}};
+            done.push_back(task.done.get_future());
+            {
+                lock_guard<mutex> lock(shards_[i].m);
+                shards_[i].tasks.push_back(move(task));
+            }
+            shards_[i].cv.notify_one();
+        }
+        // the workers write into results until their futures are ready
+        exception_ptr error;
+        for (auto& f : done) {
+            try {
+                f.get();
+            } catch (...) {
+                if (!error) {
+                    error = current_exception();
+                }
+            }
+        }
+        if (error) {
+            rethrow_exception(error);
+        }
+
+        vector<double> cheers;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            if (queries[i].type == Query::Type::Cheer) {
+                cheers.push_back(results[i]);
+            }
+        }
+        return cheers;
+    }
+
+ private:
+    // Part of a batch of queries for one shard, results are written by index
+    struct Task {
+        const vector<Query>* queries;
+        vector<size_t> indices;
+        vector<double>* results;
+        promise<void> done;
+    };
+
+    struct Shard {
+        mutex m;
+        condition_variable cv;
+        deque<Task> tasks;
+        bool stopped = false;
+        // only the worker touches the books
+        unordered_map<int, FenwickReadingManager> books;
+        thread worker;
+    };
+
+    void Work(Shard& shard) {
+        while (true) {
+            Task task;
+            {
+                unique_lock<mutex> lock(shard.m);
+                shard.cv.wait(lock, [&shard] { return shard.stopped || !shard.tasks.empty(); });
+                if (shard.tasks.empty()) {
+                    return;
+                }
+                task = move(shard.tasks.front());
+                shard.tasks.pop_front();
+            }
+            try {
+                for (size_t i : task.indices) {
+                    const Query& query = (*task.queries)[i];
+                    auto book = shard.books.try_emplace(query.book, max_page_count_).first;
+                    if (query.type == Query::Type::Read) {
+                        book->second.Read(query.user, query.page);
+                    } else {
+                        (*task.results)[i] = book->second.Cheer(query.user);
+                    }
+                }
+                task.done.set_value();
+            } catch (...) {
+                task.done.set_exception(current_exception());
+            }
+        }
+    }
+
+    const int max_page_count_;
+    vector<Shard> shards_;
+};
+
+void TestLibraryManager() {
+    {
+        LibraryManager manager(3);
+        const vector<Query> queries = {
+            {Query::Type::Cheer, 1, 1},
+            {Query::Type::Read, 1, 1, 10},
+            {Query::Type::Read, 2, 1, 5},
+            {Query::Type::Read, 2, 2, 7},
+            {Query::Type::Cheer, 1, 1},
+            {Query::Type::Cheer, 2, 1},
+            {Query::Type::Cheer, 2, 2},
+            {Query::Type::Read, 1, 2, 20},
+            {Query::Type::Cheer, 1, 1},
+            {Query::Type::Cheer, 3, 1},
+        };
+        ASSERT_EQUAL(manager.Process(queries), (vector<double>{0.0, 1.0, 0.0, 1.0, 0.0, 0.0}));
+
+        // books keep their state between batches
+        const vector<Query> more = {
+            {Query::Type::Read, 1, 1, 30},
+            {Query::Type::Cheer, 1, 1},
+            {Query::Type::Cheer, 2, 2},
+        };
+        ASSERT_EQUAL(manager.Process(more), (vector<double>{1.0, 1.0}));
+    }
+    {
+        LibraryManager manager(2);
+        try {
+            manager.Process({{Query::Type::Read, 1, 1, 1'001}});
+            ASSERT(false);
+        } catch (out_of_range&) {
+        }
+        ASSERT_EQUAL(manager.Process({{Query::Type::Read, 1, 1, 1'000}, {Query::Type::Cheer, 1, 1}}),
+                     vector<double>{1.0});
+    }
+    {
+        // the failing shard comes first and finishes at once,
+        // while the other one still writes its results
+        LibraryManager manager(2);
+        vector<Query> queries = {{Query::Type::Read, 2, 1, 1'001}};
+        for (int user = 0; user < 100'000; ++user) {
+            queries.push_back({Query::Type::Read, 1, user, user % 1'000});
+            queries.push_back({Query::Type::Cheer, 1, user});
+        }
+        try {
+            manager.Process(queries);
+            ASSERT(false);
+        } catch (out_of_range&) {
+        }
+        ASSERT_EQUAL(manager.Process({{Query::Type::Cheer, 1, 99'999}, {Query::Type::Cheer, 2, 1}}),
+                     (vector<double>{99'900.0 / 99'999, 0.0}));
+    }
+    {
+        // memory of a book doesn't depend on the values of user ids
+        LibraryManager manager(2);
+        vector<Query> queries;
+        for (int book = 0; book < 1'000; ++book) {
+            queries.push_back({Query::Type::Read, book, 2'000'000'000 - book, book % 1'000});
+            queries.push_back({Query::Type::Read, book, 0, 500});
+            queries.push_back({Query::Type::Cheer, book, 2'000'000'000 - book});
+        }
+        queries.push_back({Query::Type::Cheer, 1, 2'000'000'000});
+        const vector<double> cheers = manager.Process(queries);
+        ASSERT_EQUAL(cheers.size(), 1'001u);
+        ASSERT_EQUAL(cheers[0], 0.0);
+        ASSERT_EQUAL(cheers[999], 1.0);
+        ASSERT_EQUAL(cheers[1'000], 0.0);
+    }
+}
+
+vector<Query> GenerateQueries(size_t count, int book_count, int user_count, int max_page_count) {
+    mt19937 gen;
+    uniform_int_distribution<> book(0, book_count - 1);
+    uniform_int_distribution<> user(0, user_count - 1);
+    uniform_int_distribution<> page(0, max_page_count);
+    uniform_int_distribution<> type(0, 1);
+    vector<Query> result;
+    result.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        result.push_back({type(gen) ? Query::Type::Read : Query::Type::Cheer, book(gen), user(gen), page(gen)});
+    }
+    return result;
+}
+
+void TestMatchesReadingManagers() {
+    const auto queries = GenerateQueries(200'000, 50, 1'000, 1'000);
+    vector<FenwickReadingManager> books(50);
+    vector<double> expected;
+    for (const Query& query : queries) {
+        if (query.type == Query::Type::Read) {
+            books[query.book].Read(query.user, query.page);
+        } else {
+            expected.push_back(books[query.book].Cheer(query.user));
+        }
+    }
+
+    for (size_t shard_count : {1, 2, 7}) {
+        LibraryManager manager(shard_count);
+        vector<double> cheers;
+        for (size_t begin = 0; begin < queries.size(); begin += 30'000) {
+            const vector<Query> batch(queries.begin() + begin,
+                                      queries.begin() + min(begin + 30'000, queries.size()));
+            for (double cheer : manager.Process(batch)) {
+                cheers.push_back(cheer);
+            }
+        }
+        ASSERT_EQUAL(cheers, expected);
+    }
+}
+
+void TestSpeed() {
+    // 1000 books with 10'000 readers each, queries come in batches of 100'000
+    const auto queries = GenerateQueries(4'000'000, 1'000, 10'000, 1'000);
+    const size_t batch_size = 100'000;
+    cerr << thread::hardware_concurrency() << " hardware threads" << endl;
+    for (size_t shard_count : {1, 2, 4, 8, 16}) {
+        LibraryManager manager(shard_count);
+        LOG_DURATION(to_string(shard_count) + " shards, 4M queries");
+        for (size_t begin = 0; begin < queries.size(); begin += batch_size) {
+            manager.Process({queries.begin() + begin, queries.begin() + min(begin + batch_size, queries.size())});
+        }
+    }
+}
+
+int main() {
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
+
+    // TestRunner tr;
+    // RUN_TEST(tr, TestLibraryManager);
+    // RUN_TEST(tr, TestMatchesReadingManagers);
+    // RUN_TEST(tr, TestSpeed);
+
+    LibraryManager manager(thread::hardware_concurrency());
+
+    // READ <book> <user> <page> or CHEER <book> <user>,
+    // queries are read and run in batches
+    const size_t BATCH_SIZE = 100'000;
+    int query_count;
+    cin >> query_count;
+
+    vector<Query> batch;
+    for (int query_id = 0; query_id < query_count; ++query_id) {
+        string query_type;
+        Query query;
+        cin >> query_type >> query.book >> query.user;
+        if (query_type == "READ") {
+            query.type = Query::Type::Read;
+            cin >> query.page;
+        } else if (query_type == "CHEER") {
+            query.type = Query::Type::Cheer;
+        } else {
+            throw invalid_argument("Unknown query type " + query_type);
+        }
+        batch.push_back(query);
+
+        if (batch.size() == BATCH_SIZE || query_id + 1 == query_count) {
+            for (double cheer : manager.Process(batch)) {
+                cout << setprecision(6) << cheer << "\n";
+            }
+            batch.clear();
+        }
+    }
+
+    return 0;
+}
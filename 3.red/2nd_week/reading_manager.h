@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// Reading progress of a single book, see electronic_book.cpp.
+// Read and Cheer take O(log P) for P pages: users are counted per page
+// in a Fenwick tree, so the number of users behind a page is a prefix sum.
+// Memory doesn't depend on the values of user ids, only on their number
+class FenwickReadingManager {
+ public:
+    explicit FenwickReadingManager(int max_page_count = 1'000)
+        : readers_(max_page_count + 2) {}
+
+    void Read(int id, int page) {
+        if (page < 0 || page + 1 >= static_cast<int>(readers_.size())) {
+            throw out_of_range("Page " + to_string(page) + " is out of range");
+        }
+        int& user_page = PageOf(id);
+        if (user_page == NOT_READ) {
+            ++user_count_;
+        } else {
+            AddReaders(user_page, -1);
+        }
+        user_page = page;
+        AddReaders(page, 1);
+    }
+
+    double Cheer(int id) const {
+        const int page = FindPage(id);
+        if (page == NOT_READ) {
+            return 0.0;
+        }
+        return (user_count_ == 1)
+            ? 1.0
+            : static_cast<double>(CountReaders(page)) / (user_count_ - 1);
+    }
+
+ private:
+    static constexpr int NOT_READ = -1;
+    // ids below this number are always kept in pages_
+    static constexpr int DENSE_ID_COUNT = 1'024;
+
+    int& PageOf(int id) {
+        if (static_cast<size_t>(id) < pages_.size()) {
+            return pages_[id];
+        }
+        // pages_ grows only while it stays proportional to the number of users,
+        // a few ints per user take about as much as an entry of the hash map
+        const size_t limit = 8 * static_cast<size_t>(user_count_) + DENSE_ID_COUNT;
+        if (static_cast<size_t>(id) >= limit) {
+            return sparse_pages_.try_emplace(id, NOT_READ).first->second;
+        }
+        pages_.resize(max<size_t>(id + 1, 2 * pages_.size()), NOT_READ);
+        for (auto it = sparse_pages_.begin(); it != sparse_pages_.end(); ) {
+            if (static_cast<size_t>(it->first) < pages_.size()) {
+                pages_[it->first] = it->second;
+                it = sparse_pages_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        return pages_[id];
+    }
+
+    int FindPage(int id) const {
+        if (static_cast<size_t>(id) < pages_.size()) {
+            return pages_[id];
+        }
+        const auto it = sparse_pages_.find(id);
+        return it == sparse_pages_.end() ? NOT_READ : it->second;
+    }
+
+    // Fenwick tree over pages shifted by one, readers_[0] isn't used
+    void AddReaders(int page, int delta) {
+        for (size_t i = page + 1; i < readers_.size(); i += i & -i) {
+            readers_[i] += delta;
+        }
+    }
+
+    // Users who have read less than page pages
+    int CountReaders(int page) const {
+        int result = 0;
+        for (size_t i = page; i > 0; i -= i & -i) {
+            result += readers_[i];
+        }
+        return result;
+    }
+
+    // page of every small user id, NOT_READ for the rest
+    vector<int> pages_;
+    // pages of users with larger ids
+    unordered_map<int, int> sparse_pages_;
+    vector<int> readers_;
+    int user_count_ = 0;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// Number of distinct clients and sum of amounts per key over the events
+// of the last window_length time units, that is with time in (now - window_length, now]
+// where now is the time of the latest event.
+// Keys are dense ids, e.g. interned names, and their counters sit in a vector.
+// Events come in the order of time, all keys share one queue of events,
+// and every Add drops the events that have left the window. A key left
+// without events releases its clients, so memory depends only on the events
+// in the window and on the number of ids. Calling Expire before Add tells
+// which keys are left without events, so that their ids can be reused.
+// Add is amortized O(1), queries are O(1) and don't change anything
+class SlidingWindowCounters {
+ public:
+    explicit SlidingWindowCounters(int64_t window_length)
+        : window_length_(window_length) {}
+
+    // Drops the events that leave the window at time now and calls
+    // on_key_released with every key left without events
+    template <typename OnKeyReleased>
+    void Expire(int64_t now, OnKeyReleased on_key_released) {
+        while (!events_.empty() && events_.front().time <= now - window_length_) {
+            const Event& event = events_.front();
+            auto& counters = counters_[event.key];
+            counters.sum -= event.amount;
+            const auto client = counters.clients.find(event.client);
+            if (--client->second == 0) {
+                counters.clients.erase(client);
+                if (counters.clients.empty()) {
+                    // erase keeps the buckets of the hash map
+                    counters = {};
+                    --key_count_;
+                    on_key_released(event.key);
+                }
+            }
+            events_.pop_front();
+        }
+    }
+
+    void Add(int64_t time, size_t key, uint64_t client, uint64_t amount) {
+        Expire(time, [](size_t) {});
+        if (key >= counters_.size()) {
+            counters_.resize(key + 1);
+        }
+        auto& counters = counters_[key];
+        if (counters.clients.empty()) {
+            ++key_count_;
+        }
+        ++counters.clients[client];
+        counters.sum += amount;
+        events_.push_back({time, key, client, amount});
+    }
+
+    size_t CountClients(size_t key) const {
+        return key < counters_.size() ? counters_[key].clients.size() : 0;
+    }
+
+    uint64_t GetSum(size_t key) const {
+        return key < counters_.size() ? counters_[key].sum : 0;
+    }
+
+    // Keys with events in the window
+    size_t GetKeyCount() const {
+        return key_count_;
+    }
+
+ private:
+    struct Counters {
+        uint64_t sum = 0;
+        // events of every client in the window
+        unordered_map<uint64_t, size_t> clients;
+    };
+
+    struct Event {
+        int64_t time;
+        size_t key;
+        uint64_t client;
+        uint64_t amount;
+    };
+
+    const int64_t window_length_;
+    deque<Event> events_;
+    vector<Counters> counters_;
+    size_t key_count_ = 0;
+};
@@ -1,7 +1,13 @@
 #include <algorithm>
 #include <array>
+#include <cstdint>
+#include <future>
 #include <iostream>
 #include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <map>
 
@@ -10,20 +16,32 @@
 
 using namespace std;
 
-// TAirport should be enum with sequential items and last item TAirport::Last_
-template <typename TAirport>
+// TAirport should be enum with sequential items and last item TAirport::Last_.
+// TCount is the type of the counters and must hold the largest count:
+// the narrower it is, the less there is to clear, copy and scan
+template <typename TAirport, typename TCount = size_t>
 class AirportCounter {
+  static_assert(is_unsigned_v<TCount>, "counters should be unsigned integers");
+
  public:
   #define NUMBER(name) static_cast<uint32_t>(name)
   #define AIRPORT(num) static_cast<TAirport>(num)
   // конструктор по умолчанию: список элементов пока пуст
-  AirportCounter() = default;
+  AirportCounter() {
+    Clear();
+  }
 
   // конструктор от диапазона элементов типа TAirport
   template <typename TIterator>
   AirportCounter(TIterator begin, TIterator end) {
-    for (; begin != end; ++begin)
-      Insert(*begin);
+    Clear();
+    if constexpr (IS_CONTIGUOUS<TIterator>) {
+      if (begin != end)
+        InsertMany(&*begin, end - begin);
+    } else {
+      for (; begin != end; ++begin)
+        Insert(*begin);
+    }
   }
 
   // получить количество элементов, равных данному
@@ -44,6 +62,45 @@ class AirportCounter {
     occurrences[NUMBER(airport)] = 0;
   }
 
+  // Inserts count airports lying one after another from data. Long runs are
+  // counted into four tables in turn, so that an increment doesn't wait
+  // for the previous one to the same airport, and the tables are added
+  // to the counters in a loop the compiler vectorizes. The tables are cleared
+  // and added up for every run, so a run has to be a few times longer than
+  // the enum, and enums with many airports are counted right into the counters
+  void InsertMany(const TAirport* data, size_t count) {
+    if constexpr (SIZE <= MAX_BULK_AIRPORTS) {
+      if (count >= max(MIN_BULK_SIZE, 4 * SIZE)) {
+        InsertBulk(data, count);
+        return;
+      }
+    }
+    for (size_t i = 0; i < count; ++i)
+      Insert(data[i]);
+  }
+
+  // Adds the counts of other
+  void Merge(const AirportCounter& other) {
+    for (size_t i = 0; i < SIZE; ++i)
+      occurrences[i] += other.occurrences[i];
+  }
+  // Takes away the counts of other, none of which may exceed the count here
+  void Subtract(const AirportCounter& other) {
+    for (size_t i = 0; i < SIZE; ++i)
+      occurrences[i] -= other.occurrences[i];
+  }
+
+  // The airport with the largest count, the first one of equal ones
+  TAirport GetMostPopular() const {
+    static_assert(SIZE > 0, "there are no airports");
+    size_t result = 0;
+    for (size_t i = 1; i < SIZE; ++i) {
+      if (occurrences[i] > occurrences[result])
+        result = i;
+    }
+    return AIRPORT(result);
+  }
+
   static const size_t SIZE = NUMBER(TAirport::Last_);
   using Item = pair<TAirport, size_t>;
   using Items = array<Item, SIZE>;
@@ -60,10 +117,143 @@ class AirportCounter {
   }
 
  private:
-  array<size_t, SIZE> occurrences = {};
+  // GCC clears arrays longer than 64 bytes with rep stos, which takes longer
+  // to start than the counters of a small enum take to be set one by one
+  void Clear() {
+    if constexpr (SIZE <= MAX_UNROLLED_CLEAR_SIZE) {
+      ClearEach(make_index_sequence<SIZE>());
+    } else {
+      occurrences.fill(0);
+    }
+  }
+
+  template <size_t... Airports>
+  void ClearEach(index_sequence<Airports...>) {
+    ((occurrences[Airports] = 0), ...);
+  }
+
+  void InsertBulk(const TAirport* data, size_t count) {
+    for (size_t begin = 0; begin < count; begin += MAX_BULK_SIZE) {
+      const size_t end = min(count, begin + MAX_BULK_SIZE);
+      array<array<uint32_t, SIZE>, 4> tables = {};
+      size_t i = begin;
+      for (; i + 4 <= end; i += 4) {
+        tables[0][NUMBER(data[i])]++;
+        tables[1][NUMBER(data[i + 1])]++;
+        tables[2][NUMBER(data[i + 2])]++;
+        tables[3][NUMBER(data[i + 3])]++;
+      }
+      for (; i < end; ++i)
+        tables[0][NUMBER(data[i])]++;
+
+      for (size_t airport = 0; airport < SIZE; ++airport)
+        occurrences[airport] += tables[0][airport] + tables[1][airport] + tables[2][airport] + tables[3][airport];
+    }
+  }
+
+  // Iterators over airports lying one after another, which InsertMany takes
+  template <typename TIterator>
+  static constexpr bool IS_CONTIGUOUS = is_same_v<TIterator, TAirport*>
+      || is_same_v<TIterator, const TAirport*>
+      || is_same_v<TIterator, typename vector<TAirport>::iterator>
+      || is_same_v<TIterator, typename vector<TAirport>::const_iterator>;
+
+  static constexpr size_t MAX_UNROLLED_CLEAR_SIZE = 64;
+  // InsertMany counts runs shorter than that one by one
+  static constexpr size_t MIN_BULK_SIZE = 64;
+  // and airports of larger enums too, their tables would take over 16 KB
+  static constexpr size_t MAX_BULK_AIRPORTS = 1'024;
+  // and longer ones by parts that its 32-bit tables hold
+  static constexpr size_t MAX_BULK_SIZE = 1u << 30;
+
+  array<TCount, SIZE> occurrences;
 };
 
 
+// AirportCounter keeping its counters on the heap, for enums with too many
+// airports to keep counters on the stack. There are airport_count of them,
+// TAirport::Last_ by default. Runs of airports are counted right into the
+// counters: with that many of them increments to the same one are rare
+template <typename TAirport, typename TCount = size_t>
+class DynamicAirportCounter {
+  static_assert(is_unsigned_v<TCount>, "counters should be unsigned integers");
+
+ public:
+  explicit DynamicAirportCounter(size_t airport_count = static_cast<size_t>(TAirport::Last_))
+    : occurrences(airport_count) {
+  }
+
+  size_t Get(TAirport airport) const {
+    return occurrences[static_cast<size_t>(airport)];
+  }
+
+  void Insert(TAirport airport) {
+    occurrences[static_cast<size_t>(airport)]++;
+  }
+
+  void InsertMany(const TAirport* data, size_t count) {
+    for (size_t i = 0; i < count; ++i)
+      Insert(data[i]);
+  }
+
+  // Counters must have the same number of airports
+  void Merge(const DynamicAirportCounter& other) {
+    for (size_t i = 0; i < occurrences.size(); ++i)
+      occurrences[i] += other.occurrences[i];
+  }
+  void Subtract(const DynamicAirportCounter& other) {
+    for (size_t i = 0; i < occurrences.size(); ++i)
+      occurrences[i] -= other.occurrences[i];
+  }
+
+  // The first airport with the largest count, there must be some airports
+  TAirport GetMostPopular() const {
+    return static_cast<TAirport>(max_element(begin(occurrences), end(occurrences)) - begin(occurrences));
+  }
+
+  size_t GetAirportCount() const {
+    return occurrences.size();
+  }
+
+ private:
+  vector<TCount> occurrences;
+};
+
+// Counts count airports from data with thread_count threads. Every thread
+// counts its part of the data into its own counter, so threads write only
+// to their own memory until they are done. The counters are then merged
+// in pairs, in pairs of pairs and so on, with merges of a level going
+// in parallel. TCounter is AirportCounter or DynamicAirportCounter,
+// every thread starts with a copy of empty, which sets the number
+// of airports of a DynamicAirportCounter
+template <typename TCounter, typename TAirport>
+TCounter CountInParallel(const TAirport* data, size_t count, size_t thread_count,
+                         const TCounter& empty = TCounter()) {
+  thread_count = max<size_t>(1, min(thread_count, count));
+  vector<future<TCounter>> counters;
+  for (size_t i = 0; i < thread_count; ++i) {
+    const size_t begin = count * i / thread_count;
+    const size_t end = count * (i + 1) / thread_count;
+    counters.push_back(async(launch::async, [data, begin, end, &empty] {
+      TCounter counter = empty;
+      counter.InsertMany(data + begin, end - begin);
+      return counter;
+    }));
+  }
+
+  for (size_t step = 1; step < thread_count; step *= 2) {
+    for (size_t i = 0; i + step < thread_count; i += 2 * step) {
+      counters[i] = async(launch::async, [left = move(counters[i]), right = move(counters[i + step])]() mutable {
+        TCounter counter = left.get();
+        counter.Merge(right.get());
+        return counter;
+      });
+    }
+  }
+  return counters.front().get();
+}
+
+
 void TestMoscow() {
   enum class MoscowAirport {
     VKO,
@@ -223,6 +413,202 @@ void TestMostPopularAirport() {
   }));
 }
 
+// The same as TestManyConstructions and TestManyGetItems
+// with counters that are cheaper to clear
+void TestManyNarrowConstructions() {
+  default_random_engine rnd(20180623);
+  uniform_int_distribution<size_t> gen_airport(
+    0, static_cast<size_t>(SmallCountryAirports::Last_) - 1
+  );
+
+  array<SmallCountryAirports, 2> airports;
+  for (auto& x : airports) {
+    x = static_cast<SmallCountryAirports>(gen_airport(rnd));
+  }
+  const vector<SmallTownAirports> town_airports = {SmallTownAirports::Airport_2, SmallTownAirports::Airport_1};
+
+  uint64_t total = 0;
+  for (int step = 0; step < 100'000'000; ++step) {
+    AirportCounter<SmallCountryAirports, uint16_t> counter(begin(airports), end(airports));
+    total += counter.Get(SmallCountryAirports::Airport_1);
+    AirportCounter<SmallTownAirports, uint16_t> town_counter(begin(town_airports), end(town_airports));
+    for (const auto& [airport, count] : town_counter.GetItems()) {
+      total += count;
+    }
+  }
+  // Assert to use variable total so that compiler doesn't optimize it out
+  ASSERT(total >= 200'000'000);
+}
+
+// The same as TestMostPopularAirport with a narrow counter,
+// airports of a day counted in bulk and GetMostPopular
+void TestMostPopularAirportBulk() {
+  default_random_engine rnd(20180624);
+  uniform_int_distribution<size_t> gen_airport(
+    0, static_cast<size_t>(SmallCountryAirports::Last_) - 1
+  );
+
+  vector<SmallCountryAirports> report_airports(2'000);
+  for (auto& x : report_airports) {
+    x = static_cast<SmallCountryAirports>(gen_airport(rnd));
+  }
+
+  const int days_to_explore = 365 * 500;
+
+  vector<SmallCountryAirports> most_popular(days_to_explore);
+
+  for (int day = 0; day < days_to_explore; ++day) {
+    AirportCounter<SmallCountryAirports, uint16_t> counter(begin(report_airports), end(report_airports));
+    most_popular[day] = counter.GetMostPopular();
+  }
+
+  ASSERT(all_of(begin(most_popular), end(most_popular), [&](SmallCountryAirports a) {
+    return a == most_popular.front();
+  }));
+}
+
+template <typename TCount>
+void CheckBulkOperations() {
+  default_random_engine rnd(20181017);
+  uniform_int_distribution<size_t> gen_airport(
+    0, static_cast<size_t>(SmallCountryAirports::Last_) - 1
+  );
+  vector<SmallCountryAirports> airports(10'003);
+  for (auto& x : airports) {
+    x = static_cast<SmallCountryAirports>(gen_airport(rnd));
+  }
+
+  using Counter = AirportCounter<SmallCountryAirports, TCount>;
+  Counter one_by_one;
+  for (auto airport : airports) {
+    one_by_one.Insert(airport);
+  }
+  const Counter bulk(airports.data(), airports.data() + airports.size());
+  const Counter part(airports.data(), airports.data() + 10);
+  for (size_t i = 0; i < Counter::SIZE; ++i) {
+    const auto airport = static_cast<SmallCountryAirports>(i);
+    ASSERT_EQUAL(bulk.Get(airport), one_by_one.Get(airport));
+  }
+
+  Counter merged = bulk;
+  merged.Merge(part);
+  merged.Subtract(bulk);
+  for (size_t i = 0; i < Counter::SIZE; ++i) {
+    const auto airport = static_cast<SmallCountryAirports>(i);
+    ASSERT_EQUAL(merged.Get(airport), part.Get(airport));
+  }
+
+  const auto items = bulk.GetItems();
+  ASSERT(bulk.GetMostPopular() == max_element(begin(items), end(items), [](auto lhs, auto rhs) {
+    return lhs.second < rhs.second;
+  })->first);
+}
+
+void TestBulkOperations() {
+  CheckBulkOperations<uint16_t>();
+  CheckBulkOperations<uint32_t>();
+  CheckBulkOperations<uint64_t>();
+
+  // the first of the most popular ones
+  const vector<SmallTownAirports> airports = {SmallTownAirports::Airport_2, SmallTownAirports::Airport_1};
+  AirportCounter<SmallTownAirports, uint16_t> counter(begin(airports), end(airports));
+  ASSERT(counter.GetMostPopular() == SmallTownAirports::Airport_1);
+  static_assert(sizeof(counter) == 2 * sizeof(uint16_t));
+}
+
+enum class WorldAirports : uint32_t {
+  Last_ = 100'000
+};
+
+template <typename TAirport, typename TCounter>
+vector<size_t> GetCounts(const TCounter& counter, size_t airport_count = static_cast<size_t>(TAirport::Last_)) {
+  vector<size_t> result(airport_count);
+  for (size_t i = 0; i < result.size(); ++i) {
+    result[i] = counter.Get(static_cast<TAirport>(i));
+  }
+  return result;
+}
+
+template <typename TCounter, typename TAirport>
+void CheckCountInParallel(const vector<TAirport>& airports) {
+  TCounter expected;
+  expected.InsertMany(airports.data(), airports.size());
+  for (size_t thread_count : {1, 2, 3, 5, 8}) {
+    const TCounter counter = CountInParallel<TCounter>(airports.data(), airports.size(), thread_count);
+    ASSERT(GetCounts<TAirport>(counter) == GetCounts<TAirport>(expected));
+  }
+}
+
+void TestCountInParallel() {
+  default_random_engine rnd(20181018);
+  {
+    uniform_int_distribution<size_t> gen_airport(
+      0, static_cast<size_t>(SmallCountryAirports::Last_) - 1
+    );
+    vector<SmallCountryAirports> airports(100'001);
+    for (auto& x : airports) {
+      x = static_cast<SmallCountryAirports>(gen_airport(rnd));
+    }
+    CheckCountInParallel<AirportCounter<SmallCountryAirports, uint32_t>>(airports);
+    CheckCountInParallel<DynamicAirportCounter<SmallCountryAirports>>(airports);
+  }
+  {
+    uniform_int_distribution<size_t> gen_airport(
+      0, static_cast<size_t>(WorldAirports::Last_) - 1
+    );
+    vector<WorldAirports> airports(100'001, WorldAirports{7});
+    for (size_t i = 0; i < airports.size(); i += 2) {
+      airports[i] = static_cast<WorldAirports>(gen_airport(rnd));
+    }
+    CheckCountInParallel<DynamicAirportCounter<WorldAirports, uint32_t>>(airports);
+
+    auto counter = CountInParallel<DynamicAirportCounter<WorldAirports, uint32_t>>(airports.data(), airports.size(), 4);
+    ASSERT(counter.GetMostPopular() == WorldAirports{7});
+    counter.Subtract(counter);
+    ASSERT_EQUAL(counter.Get(WorldAirports{7}), 0u);
+  }
+  {
+    // more airports than WorldAirports::Last_, known only at run time
+    const size_t airport_count = 250'000 + rnd() % 10;
+    vector<WorldAirports> airports(100'001, WorldAirports{7});
+    for (size_t i = 0; i < airports.size(); i += 2) {
+      airports[i] = static_cast<WorldAirports>(rnd() % airport_count);
+    }
+    airports.back() = static_cast<WorldAirports>(airport_count - 1);
+    const DynamicAirportCounter<WorldAirports, uint32_t> empty(airport_count);
+    DynamicAirportCounter<WorldAirports, uint32_t> expected(airport_count);
+    expected.InsertMany(airports.data(), airports.size());
+    for (size_t thread_count : {1, 3, 8}) {
+      const auto counter = CountInParallel(airports.data(), airports.size(), thread_count, empty);
+      ASSERT_EQUAL(counter.GetAirportCount(), airport_count);
+      ASSERT(GetCounts<WorldAirports>(counter, airport_count) == GetCounts<WorldAirports>(expected, airport_count));
+    }
+  }
+  ASSERT_EQUAL(CountInParallel<AirportCounter<SmallTownAirports>>(
+    static_cast<const SmallTownAirports*>(nullptr), 0, 4).Get(SmallTownAirports::Airport_1), 0u);
+}
+
+enum class ReportAirports : uint8_t {
+  Last_ = 15
+};
+
+void TestCountInParallelSpeed() {
+  // 10^8 flights, that is 2 * 10^8 airports one byte each
+  default_random_engine rnd(20181018);
+  vector<ReportAirports> airports(200'000'000);
+  for (auto& x : airports) {
+    x = static_cast<ReportAirports>(rnd() % static_cast<size_t>(ReportAirports::Last_));
+  }
+  cerr << thread::hardware_concurrency() << " hardware threads" << endl;
+  for (size_t thread_count = 1; thread_count <= 32; thread_count *= 2) {
+    LOG_DURATION(to_string(thread_count) + " threads");
+    const auto counter = CountInParallel<AirportCounter<ReportAirports, uint32_t>>(
+      airports.data(), airports.size(), thread_count
+    );
+    ASSERT(counter.Get(counter.GetMostPopular()) > 0);
+  }
+}
+
 int main() {
   TestRunner tr;
 
@@ -238,5 +624,10 @@ int main() {
   RUN_TEST(tr, TestManyConstructions);
   RUN_TEST(tr, TestManyGetItems);
   RUN_TEST(tr, TestMostPopularAirport);
+  RUN_TEST(tr, TestManyNarrowConstructions);
+  RUN_TEST(tr, TestMostPopularAirportBulk);
+  RUN_TEST(tr, TestBulkOperations);
+  RUN_TEST(tr, TestCountInParallel);
+  // RUN_TEST(tr, TestCountInParallelSpeed);
   return 0;
 }
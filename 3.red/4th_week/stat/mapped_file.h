@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+// A file mapped into memory for reading, as a string_view
+class MappedFile {
+ public:
+  explicit MappedFile(const string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw runtime_error("Can't open " + path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+      close(fd);
+      throw runtime_error("Can't stat " + path);
+    }
+    size = info.st_size;
+    if (size > 0) {
+      data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (data == MAP_FAILED) {
+      throw runtime_error("Can't map " + path);
+    }
+    if (data) {
+      // the file is read through once
+      madvise(data, size, MADV_SEQUENTIAL);
+    }
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+    if (data) {
+      munmap(data, size);
+    }
+  }
+
+  string_view GetContents() const {
+    return {static_cast<const char*>(data), size};
+  }
+
+ private:
+  void* data = nullptr;
+  size_t size = 0;
+};
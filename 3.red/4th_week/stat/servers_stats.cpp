@@ -1,23 +1,74 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
 #include <map>
+#include <random>
+#include <stdexcept>
 #include <string_view>
+#include <thread>
+#include <vector>
 
 #include "test_runner.h"
 #include "profile.h"
 #include "http_request.h"
+#include "mapped_file.h"
 #include "stats.h"
 
+#include <unistd.h>
+
 using namespace std;
 
-Stats ServeRequests(istream& input) {
-  Stats result;
+Stats ServeRequests(istream& input, shared_ptr<const StatsSchema> schema = StatsSchema::GetDefault()) {
+  Stats result(move(schema));
   for (string line; getline(input, line); ) {
-    const HttpRequest req = ParseRequest(line);
-    result.AddUri(req.uri);
-    result.AddMethod(req.method);
+    result.Add(ParseRequest(line));
+  }
+  return result;
+}
+
+// Same as ServeRequests for the lines of text
+Stats ServeLines(string_view text, shared_ptr<const StatsSchema> schema) {
+  Stats result(move(schema));
+  while (!text.empty()) {
+    const char* end = static_cast<const char*>(memchr(text.data(), '\n', text.size()));
+    const size_t line_size = end ? end - text.data() : text.size();
+    result.Add(ParseRequest(text.substr(0, line_size)));
+    text.remove_prefix(end ? line_size + 1 : line_size);
   }
   return result;
 }
 
+// Splits the text into thread_count pieces of whole lines,
+// counts them in parallel and merges the counts
+Stats ServeRequestsParallel(string_view text, size_t thread_count,
+                            shared_ptr<const StatsSchema> schema = StatsSchema::GetDefault()) {
+  thread_count = max<size_t>(thread_count, 1);
+  vector<future<Stats>> futures;
+  while (!text.empty()) {
+    size_t size = min(text.size(), text.size() / thread_count-- + 1);
+    if (const size_t line_end = text.find('\n', size - 1); line_end != text.npos) {
+      size = line_end + 1;
+    } else {
+      size = text.size();
+    }
+    futures.push_back(async(launch::async, ServeLines, text.substr(0, size), schema));
+    text.remove_prefix(size);
+  }
+
+  Stats result(schema);
+  for (auto& f : futures) {
+    result.Merge(f.get());
+  }
+  return result;
+}
+
+Stats ServeRequestsFromFile(const string& path, size_t thread_count,
+                            shared_ptr<const StatsSchema> schema = StatsSchema::GetDefault()) {
+  const MappedFile file(path);
+  return ServeRequestsParallel(file.GetContents(), thread_count, move(schema));
+}
+
 void TestBasic() {
   const string input =
     R"(GET / HTTP/1.1
@@ -36,14 +87,14 @@ void TestBasic() {
     GET /unexpected HTTP/1.1
     HEAD / HTTP/1.1)";
 
-  const map<string_view, int> expected_method_count = {
+  const map<string_view, uint64_t> expected_method_count = {
     {"GET", 8},
     {"PUT", 1},
     {"POST", 4},
     {"DELETE", 1},
     {"UNKNOWN", 1},
   };
-  const map<string_view, int> expected_url_count = {
+  const map<string_view, uint64_t> expected_url_count = {
     {"/", 4},
     {"/order", 2},
     {"/product", 5},
@@ -63,14 +114,14 @@ void TestAbsentParts() {
   // Методы GetMethodStats и GetUriStats должны возвращать словари
   // с полным набором ключей, даже если какой-то из них не встречался
 
-  const map<string_view, int> expected_method_count = {
+  const map<string_view, uint64_t> expected_method_count = {
     {"GET", 0},
     {"PUT", 0},
     {"POST", 0},
     {"DELETE", 0},
     {"UNKNOWN", 0},
   };
-  const map<string_view, int> expected_url_count = {
+  const map<string_view, uint64_t> expected_url_count = {
     {"/", 0},
     {"/order", 0},
     {"/product", 0},
@@ -84,8 +135,263 @@ void TestAbsentParts() {
   ASSERT_EQUAL(default_constructed.GetUriStats(), expected_url_count);
 }
 
-int main() {
+static_assert(PackPrefix("GET") == 0x544547);
+static_assert(PackPrefix("/product/basket") == PackPrefix("/product"));
+
+void TestKeyClassifier() {
+  for (string_view key : {"", "a", "ab", "abc", "abcd", "abcde", "abcdefg", "abcdefgh", "abcdefghi"}) {
+    ASSERT_EQUAL(LoadPrefix(key), PackPrefix(key));
+  }
+
+  const vector<string> keys = {"GET", "/product", "/product/basket"};
+  const KeyClassifier classifier(keys, "none");
+  ASSERT_EQUAL(classifier.Classify("GET"), 0u);
+  ASSERT_EQUAL(classifier.Classify("/product"), 1u);
+  ASSERT_EQUAL(classifier.Classify("/product/basket"), 2u);
+
+  // same 8 first bytes, different lengths or tails
+  ASSERT_EQUAL(classifier.Classify("/products"), 3u);
+  ASSERT_EQUAL(classifier.Classify("/product/basked"), 3u);
+  ASSERT_EQUAL(classifier.Classify("/product/basket/"), 3u);
+  ASSERT_EQUAL(classifier.Classify("GE"), 3u);
+  ASSERT_EQUAL(classifier.Classify(string_view("GET\0", 4)), 3u);
+  ASSERT_EQUAL(classifier.Classify(""), 3u);
+  ASSERT_EQUAL(classifier.GetKey(3), "none");
+
+  // too many keys to check one by one
+  vector<string> many_keys;
+  for (int i = 0; i < 100; ++i) {
+    many_keys.push_back("/" + to_string(i));
+  }
+  const KeyClassifier many(many_keys, "none");
+  ASSERT_EQUAL(many.Classify("/42"), 42u);
+  ASSERT_EQUAL(many.Classify("/100"), 100u);
+}
+
+void TestPrefixClassifier() {
+  const vector<string> prefixes = {"/api/", "/api/v1/", "/api/v2/", "/static", "/api/v1/users", "/a"};
+  const PrefixClassifier classifier(prefixes, "other");
+  ASSERT_EQUAL(classifier.Classify("/api/v1/orders"), 1u);
+  ASSERT_EQUAL(classifier.Classify("/api/v1/users/1"), 4u);
+  ASSERT_EQUAL(classifier.Classify("/api/v1/user"), 1u);
+  ASSERT_EQUAL(classifier.Classify("/api/v3/"), 0u);
+  ASSERT_EQUAL(classifier.Classify("/api/v2/"), 2u);
+  ASSERT_EQUAL(classifier.Classify("/api"), 5u);
+  ASSERT_EQUAL(classifier.Classify("/static/logo.png"), 3u);
+  ASSERT_EQUAL(classifier.Classify("/stat"), 6u);
+  ASSERT_EQUAL(classifier.Classify(""), 6u);
+  ASSERT_EQUAL(classifier.GetKey(6), "other");
+
+  const vector<string> none;
+  ASSERT_EQUAL(PrefixClassifier(none, "other").Classify("/api/"), 0u);
+}
+
+void TestConfiguredStats() {
+  istringstream config(R"(# methods we serve
+method GET
+method HEAD
+uri /
+protocol HTTP/1.1
+protocol HTTP/2
+default_protocol other
+uri_prefix /product
+uri_prefix /product/
+uri_prefix /help
+)");
+  const auto schema = make_shared<const StatsSchema>(ReadStatsKeys(config));
+
+  istringstream input(R"(GET / HTTP/1.1
+    HEAD /product/1 HTTP/2
+    POST /product HTTP/1.1
+    GET /help/me HTTP/1.0
+    GET /basket
+    DELETE /productive HTTP/1.1)");
+  const Stats stats = ServeRequests(input, schema);
+
+  ASSERT_EQUAL(stats.GetMethodStats(), (map<string_view, uint64_t>{{"GET", 3}, {"HEAD", 1}, {"UNKNOWN", 2}}));
+  ASSERT_EQUAL(stats.GetUriStats(), (map<string_view, uint64_t>{{"/", 1}, {"unknown", 5}}));
+  ASSERT_EQUAL(stats.GetProtocolStats(), (map<string_view, uint64_t>{{"HTTP/1.1", 3}, {"HTTP/2", 1}, {"other", 2}}));
+  ASSERT_EQUAL(stats.GetUriPrefixStats(),
+               (map<string_view, uint64_t>{{"/product", 2}, {"/product/", 1}, {"/help", 1}, {"other", 2}}));
+
+  Stats default_stats;
+  try {
+    default_stats.Merge(stats);
+    ASSERT(false);
+  } catch (invalid_argument&) {
+  }
+
+  istringstream wrong("methods GET");
+  try {
+    ReadStatsKeys(wrong);
+    ASSERT(false);
+  } catch (invalid_argument&) {
+  }
+
+  // lines of a set may be far apart, the line buffer is reused meanwhile
+  istringstream spread("method GET\n"
+                       "# " + string(100, 'x') + "\n"
+                       "uri /x\n"
+                       "method POST\n"
+                       "uri /" + string(100, 'y') + "\n"
+                       "method PUT\n");
+  const StatsKeys keys = ReadStatsKeys(spread);
+  ASSERT_EQUAL(keys.methods, (vector<string>{"GET", "POST", "PUT"}));
+  ASSERT_EQUAL(keys.uris, (vector<string>{"/x", "/" + string(100, 'y')}));
+}
+
+void TestClassifySpeed() {
+  const vector<string> tokens = {"GET", "POST", "PUT", "DELETE", "HEAD", "/", "/order",
+                                 "/product", "/basket", "/help", "/upyachka", "/unexpected"};
+  mt19937 gen;
+  vector<string_view> values;
+  for (int i = 0; i < 10'000'000; ++i) {
+    values.push_back(tokens[gen() % tokens.size()]);
+  }
+
+  Stats stats;
+  {
+    LOG_DURATION("Stats, 10^7 tokens");
+    for (string_view value : values) {
+      if (value[0] == '/') {
+        stats.AddUri(value);
+      } else {
+        stats.AddMethod(value);
+      }
+    }
+  }
+
+  // the way StatPiece counted before
+  map<string_view, uint64_t> methods = stats.GetMethodStats();
+  map<string_view, uint64_t> uris = stats.GetUriStats();
+  for (auto& kv : methods) {
+    kv.second = 0;
+  }
+  for (auto& kv : uris) {
+    kv.second = 0;
+  }
+  {
+    LOG_DURATION("map<string_view, uint64_t>, 10^7 tokens");
+    for (string_view value : values) {
+      auto& counts = value[0] == '/' ? uris : methods;
+      if (auto it = counts.find(value); it != counts.end()) {
+        ++it->second;
+      } else {
+        ++counts[value[0] == '/' ? "unknown" : "UNKNOWN"];
+      }
+    }
+  }
+  ASSERT_EQUAL(stats.GetMethodStats(), methods);
+  ASSERT_EQUAL(stats.GetUriStats(), uris);
+}
+
+void TestParallel() {
+  // a line in every chunk, lines split by chunks, no newline at the end
+  vector<string> lines = {"GET / HTTP/1.1", "POST /order HTTP/1.1", "", "  HEAD /help HTTP/1.0",
+                          "DELETE /basket HTTP/1.1", "PUT /product/1 HTTP/1.1", "GET /order"};
+  mt19937 gen;
+  for (int i = 0; i < 1'000; ++i) {
+    lines.push_back(lines[gen() % lines.size()]);
+  }
+
+  for (size_t line_count : {0, 1, 2, 7, 1'000}) {
+    string text;
+    for (size_t i = 0; i < line_count; ++i) {
+      text += lines[i];
+      text += '\n';
+    }
+    for (const string& input : {text, text + "GET /help", text + "\n"}) {
+      istringstream is(input);
+      const Stats expected = ServeRequests(is);
+      for (size_t thread_count : {1, 2, 3, 16}) {
+        const Stats stats = ServeRequestsParallel(input, thread_count);
+        const string hint = to_string(line_count) + " lines, " + to_string(thread_count) + " threads";
+        AssertEqual(stats.GetMethodStats(), expected.GetMethodStats(), hint);
+        AssertEqual(stats.GetUriStats(), expected.GetUriStats(), hint);
+      }
+    }
+  }
+
+  // runs at once don't share the file
+  const string path = (filesystem::temp_directory_path()
+                       / ("servers_stats_test." + to_string(getpid()) + ".log")).string();
+  {
+    ofstream output(path);
+    for (const auto& line : lines) {
+      output << line << '\n';
+    }
+  }
+  ifstream input(path);
+  const Stats expected = ServeRequests(input);
+  const Stats stats = ServeRequestsFromFile(path, 4);
+  ASSERT_EQUAL(stats.GetMethodStats(), expected.GetMethodStats());
+  ASSERT_EQUAL(stats.GetUriStats(), expected.GetUriStats());
+  filesystem::remove(path);
+}
+
+void TestParallelSpeed() {
+  const vector<string> lines = {"GET / HTTP/1.1", "POST /order HTTP/1.1", "POST /product HTTP/1.1",
+                                "GET /basket HTTP/1.1", "DELETE /product HTTP/1.1", "GET /help HTTP/1.1",
+                                "HEAD /upyachka HTTP/1.1", "GET /unexpected/path?query=1 HTTP/1.1"};
+  const string path = (filesystem::temp_directory_path()
+                       / ("servers_stats_speed." + to_string(getpid()) + ".log")).string();
+  {
+    mt19937 gen;
+    ofstream output(path);
+    for (int i = 0; i < 5'000'000; ++i) {
+      output << lines[gen() % lines.size()] << '\n';
+    }
+  }
+  const double gigabytes = filesystem::file_size(path) / 1e9;
+  cerr << gigabytes << " GB, " << thread::hardware_concurrency() << " hardware threads" << endl;
+
+  const auto measure = [gigabytes](const string& name, auto serve) {
+    const auto start = chrono::steady_clock::now();
+    const Stats stats = serve();
+    const chrono::duration<double> seconds = chrono::steady_clock::now() - start;
+    cerr << name << ": " << seconds.count() << " s, " << gigabytes / seconds.count() << " GB/s" << endl;
+    return stats;
+  };
+
+  const Stats expected = measure("getline", [&path] {
+    ifstream input(path);
+    return ServeRequests(input);
+  });
+  for (size_t thread_count : {1, 2, 4, 8}) {
+    const Stats stats = measure("mmap, " + to_string(thread_count) + " threads", [&path, thread_count] {
+      return ServeRequestsFromFile(path, thread_count);
+    });
+    ASSERT_EQUAL(stats.GetMethodStats(), expected.GetMethodStats());
+    ASSERT_EQUAL(stats.GetUriStats(), expected.GetUriStats());
+  }
+  filesystem::remove(path);
+}
+
+// Prints the stats of the log file given, counted by the keys read from
+// the second file if there is one, or runs the tests
+int main(int argc, char* argv[]) {
+  if (argc > 1) {
+    auto schema = StatsSchema::GetDefault();
+    if (argc > 2) {
+      ifstream keys(argv[2]);
+      if (!keys) {
+        throw runtime_error("Can't open " + string(argv[2]));
+      }
+      schema = make_shared<const StatsSchema>(ReadStatsKeys(keys));
+    }
+    const Stats stats = ServeRequestsFromFile(argv[1], thread::hardware_concurrency(), schema);
+    cout << stats.GetMethodStats() << endl << stats.GetUriStats() << endl
+         << stats.GetProtocolStats() << endl << stats.GetUriPrefixStats() << endl;
+    return 0;
+  }
+
   TestRunner tr;
   RUN_TEST(tr, TestBasic);
   RUN_TEST(tr, TestAbsentParts);
+  RUN_TEST(tr, TestKeyClassifier);
+  RUN_TEST(tr, TestPrefixClassifier);
+  RUN_TEST(tr, TestConfiguredStats);
+  RUN_TEST(tr, TestClassifySpeed);
+  RUN_TEST(tr, TestParallel);
+  // RUN_TEST(tr, TestParallelSpeed);
 }
@@ -1,21 +1,155 @@
 #include "stats.h"
 
-void Stats::AddMethod(string_view method) {
-  methods.Add(method);
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+
+string_view ReadToken(string_view& sv);
+
+KeyClassifier::KeyClassifier(const vector<string>& keys, string_view default_key)
+  : keys(keys.begin(), keys.end())
+  , default_key(default_key) {
+  if (keys.size() <= MAX_SCANNED_KEYS) {
+    for (const string& key : keys) {
+      heads.push_back({PackPrefix(key), key.size()});
+    }
+  } else {
+    for (size_t i = 0; i < keys.size(); ++i) {
+      index.emplace(keys[i], i);
+    }
+  }
+}
+
+PrefixClassifier::PrefixClassifier(const vector<string>& prefixes, string_view default_key)
+  : prefixes(prefixes.begin(), prefixes.end())
+  , default_key(default_key)
+  , nodes(1) {
+  for (size_t i = 0; i < prefixes.size(); ++i) {
+    Insert(prefixes[i], i);
+  }
+}
+
+void PrefixClassifier::Insert(string_view prefix, uint32_t number) {
+  uint32_t node = 0;
+  while (!prefix.empty()) {
+    uint32_t child = NO_NODE;
+    size_t child_position = 0;
+    for (; child_position < nodes[node].children.size(); ++child_position) {
+      if (nodes[nodes[node].children[child_position]].label[0] == prefix[0]) {
+        child = nodes[node].children[child_position];
+        break;
+      }
+    }
+    if (child == NO_NODE) {
+      nodes.push_back({prefix, NO_PREFIX, {}});
+      nodes[node].children.push_back(nodes.size() - 1);
+      node = nodes.size() - 1;
+      break;
+    }
+
+    const string_view label = nodes[child].label;
+    const size_t common = mismatch(label.begin(), label.end(), prefix.begin(), prefix.end()).first - label.begin();
+    if (common < label.size()) {
+      // the edge is split by a new node holding the common part
+      nodes.push_back({label.substr(0, common), NO_PREFIX, {child}});
+      nodes[child].label.remove_prefix(common);
+      nodes[node].children[child_position] = nodes.size() - 1;
+      child = nodes.size() - 1;
+    }
+    prefix.remove_prefix(common);
+    node = child;
+  }
+  // the first of equal prefixes wins
+  if (nodes[node].prefix == NO_PREFIX) {
+    nodes[node].prefix = number;
+  }
+}
+
+StatsKeys ReadStatsKeys(istream& input) {
+  StatsKeys result;
+  const map<string_view, vector<string>*> sets = {
+    {"method", &result.methods},
+    {"uri", &result.uris},
+    {"protocol", &result.protocols},
+    {"uri_prefix", &result.uri_prefixes},
+  };
+  const map<string_view, string*> defaults = {
+    {"default_method", &result.default_method},
+    {"default_uri", &result.default_uri},
+    {"default_protocol", &result.default_protocol},
+    {"default_uri_prefix", &result.default_uri_prefix},
+  };
+  // sets met in the input, their built-in keys are dropped
+  set<vector<string>*> replaced;
+
+  for (string line; getline(input, line); ) {
+    string_view rest = line;
+    const string_view name = ReadToken(rest);
+    const string_view key = ReadToken(rest);
+    if (name.empty() || name[0] == '#') {
+      continue;
+    }
+    if (const auto it = sets.find(name); it != sets.end()) {
+      if (replaced.insert(it->second).second) {
+        it->second->clear();
+      }
+      it->second->emplace_back(key);
+    } else if (const auto it = defaults.find(name); it != defaults.end()) {
+      *it->second = key;
+    } else {
+      throw invalid_argument("Unknown set of keys: " + string(name));
+    }
+  }
+  return result;
+}
+
+StatsSchema::StatsSchema(StatsKeys keys)
+  : keys(move(keys))
+  , methods(this->keys.methods, this->keys.default_method)
+  , uris(this->keys.uris, this->keys.default_uri)
+  , protocols(this->keys.protocols, this->keys.default_protocol)
+  , uri_prefixes(this->keys.uri_prefixes, this->keys.default_uri_prefix) {
+}
+
+shared_ptr<const StatsSchema> StatsSchema::GetDefault() {
+  static const auto schema = make_shared<const StatsSchema>();
+  return schema;
+}
+
+Stats::Stats(shared_ptr<const StatsSchema> schema)
+  : schema(move(schema))
+  , methods(this->schema->methods)
+  , uris(this->schema->uris)
+  , protocols(this->schema->protocols)
+  , uri_prefixes(this->schema->uri_prefixes) {
 }
 
-void Stats::AddUri(string_view uri) {
-  uris.Add(uri);
+void Stats::Merge(const Stats& other) {
+  if (schema != other.schema) {
+    throw invalid_argument("Stats of different schemas can't be merged");
+  }
+  methods.Merge(other.methods);
+  uris.Merge(other.uris);
+  protocols.Merge(other.protocols);
+  uri_prefixes.Merge(other.uri_prefixes);
 }
 
-const map<string_view, int>& Stats::GetMethodStats() const {
+map<string_view, uint64_t> Stats::GetMethodStats() const {
   return methods.GetValues();
 }
 
-const map<string_view, int>& Stats::GetUriStats() const {
+map<string_view, uint64_t> Stats::GetUriStats() const {
   return uris.GetValues();
 }
 
+map<string_view, uint64_t> Stats::GetProtocolStats() const {
+  return protocols.GetValues();
+}
+
+map<string_view, uint64_t> Stats::GetUriPrefixStats() const {
+  return uri_prefixes.GetValues();
+}
+
 void LeftStrip(string_view& sv) {
   while (!sv.empty() && isspace(sv[0])) {
     sv.remove_prefix(1);
@@ -36,11 +170,3 @@ HttpRequest ParseRequest(string_view line) {
   auto uri = ReadToken(line);
   return {method, uri, ReadToken(line)};
 }
-
-void StatPiece::Add(string_view value) {
-  if (auto it = counts.find(value); it != counts.end()) {
-    ++it->second;
-  } else {
-    ++counts[default_key];
-  }
-}
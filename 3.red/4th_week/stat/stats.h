@@ -1,59 +1,282 @@
 #pragma once
-#include <array>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <memory>
 #include <string>
 #include <string_view>
 #include <map>
+#include <unordered_map>
+#include <vector>
 
 #include "http_request.h"
 
 using namespace std;
 
-class StatPiece {
+// Up to 8 first bytes of a key as an integer, missing bytes are zero
+constexpr uint64_t PackPrefix(string_view key) {
+  uint64_t result = 0;
+  for (size_t i = 0; i < key.size() && i < 8; ++i) {
+    result |= uint64_t(static_cast<unsigned char>(key[i])) << (8 * i);
+  }
+  return result;
+}
+
+// Same as PackPrefix, with a few loads of fixed size instead of a loop
+inline uint64_t LoadPrefix(string_view key) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  const char* data = key.data();
+  const size_t size = key.size();
+  if (size >= 8) {
+    uint64_t result;
+    memcpy(&result, data, 8);
+    return result;
+  }
+  if (size >= 4) {
+    // the two halves overlap unless size is 8
+    uint32_t low, high;
+    memcpy(&low, data, 4);
+    memcpy(&high, data + size - 4, 4);
+    return low | uint64_t(high) << (8 * (size - 4));
+  }
+  if (size > 0) {
+    return uint64_t(static_cast<unsigned char>(data[0]))
+      | uint64_t(static_cast<unsigned char>(data[size / 2])) << (8 * (size / 2))
+      | uint64_t(static_cast<unsigned char>(data[size - 1])) << (8 * (size - 1));
+  }
+  return 0;
+#else
+  return PackPrefix(key);
+#endif
+}
+
+// Finds a key among fixed ones. A few keys are checked one by one, comparing
+// the length and the first 8 bytes of every key as two integers and the rest
+// of longer keys bytewise; more keys are looked up in a hash table.
+// Values of no key get number GetKeyCount()
+class KeyClassifier {
  public:
-  template <typename Container>
-  StatPiece(const Container& known_keys, string_view default_key)
-    : default_key(default_key) {
-    counts[default_key] = 0;
-    for (string_view key : known_keys) {
-      counts[key] = 0;
+  // Keys must outlive the classifier
+  KeyClassifier(const vector<string>& keys, string_view default_key);
+
+  size_t Classify(string_view value) const {
+    if (!index.empty()) {
+      const auto it = index.find(value);
+      return it == index.end() ? keys.size() : it->second;
+    }
+    const uint64_t prefix = LoadPrefix(value);
+    for (size_t i = 0; i < heads.size(); ++i) {
+      if (heads[i].prefix == prefix && heads[i].size == value.size()
+          && (value.size() <= 8 || keys[i].substr(8) == value.substr(8))) {
+        return i;
+      }
     }
+    return keys.size();
   }
 
-  void Add(string_view value);
+  size_t GetKeyCount() const {
+    return keys.size();
+  }
 
-  const map<string_view, int>& GetValues() const {
-    return counts;
+  // GetKey(GetKeyCount()) is the default key
+  string_view GetKey(size_t i) const {
+    return i < keys.size() ? keys[i] : default_key;
   }
 
  private:
-  const string_view default_key;
-  map<string_view, int> counts;
+  static const size_t MAX_SCANNED_KEYS = 16;
+
+  // what is compared first, kept together
+  struct Head {
+    uint64_t prefix;
+    size_t size;
+  };
+
+  vector<string_view> keys;
+  vector<Head> heads;
+  string_view default_key;
+  unordered_map<string_view, size_t> index;
 };
 
-class Stats {
+// Finds the longest of fixed prefixes of a value in a radix tree,
+// values with none of them get number GetKeyCount()
+class PrefixClassifier {
  public:
-  Stats() = default;
+  // Prefixes must outlive the classifier
+  PrefixClassifier(const vector<string>& prefixes, string_view default_key);
 
-  void AddMethod(string_view method);
-  void AddUri(string_view uri);
-  const map<string_view, int>& GetMethodStats() const;
-  const map<string_view, int>& GetUriStats() const;
+  size_t Classify(string_view value) const {
+    size_t result = prefixes.size();
+    if (result == 0) {
+      return result;
+    }
+    uint32_t node = 0;
+    while (true) {
+      if (nodes[node].prefix != NO_PREFIX) {
+        result = nodes[node].prefix;
+      }
+      const uint32_t child = FindChild(node, value);
+      if (child == NO_NODE) {
+        return result;
+      }
+      value.remove_prefix(nodes[child].label.size());
+      node = child;
+    }
+  }
+
+  size_t GetKeyCount() const {
+    return prefixes.size();
+  }
+
+  string_view GetKey(size_t i) const {
+    return i < prefixes.size() ? prefixes[i] : default_key;
+  }
 
  private:
-  // Ключевое слово inline позволяет определить статические члены
-  // known_methods, default_method и т.д. здесь, в .h-файле. Без
-  // него нам бы пришлось объявить их здесь, а определеление вынести
-  // в stats.cpp
-  inline static const array<string, 4> known_methods = {"GET", "POST", "DELETE", "PUT"};
+  static const uint32_t NO_NODE = -1;
+  static const uint32_t NO_PREFIX = -1;
+
+  struct Node {
+    // bytes on the edge from the parent
+    string_view label;
+    uint32_t prefix = NO_PREFIX;
+    // children start with distinct bytes
+    vector<uint32_t> children;
+  };
+
+  // The child whose label value starts with
+  uint32_t FindChild(uint32_t node, string_view value) const {
+    if (value.empty()) {
+      return NO_NODE;
+    }
+    for (const uint32_t child : nodes[node].children) {
+      const string_view label = nodes[child].label;
+      if (label[0] == value[0]) {
+        return value.substr(0, label.size()) == label ? child : NO_NODE;
+      }
+    }
+    return NO_NODE;
+  }
 
-  inline static const string default_method = "UNKNOWN";
+  void Insert(string_view prefix, uint32_t number);
 
-  inline static const array<string, 5> known_uris = {"/", "/product", "/basket", "/help", "/order"};
+  vector<string_view> prefixes;
+  string_view default_key;
+  // the root has an empty label
+  vector<Node> nodes;
+};
+
+// Counts values by the keys of a classifier
+template <typename Classifier>
+class StatPiece {
+ public:
+  explicit StatPiece(const Classifier& classifier)
+    : classifier(&classifier)
+    , counts(classifier.GetKeyCount() + 1) {
+  }
 
-  inline static const string default_uri = "unknown";
+  void Add(string_view value) {
+    ++counts[classifier->Classify(value)];
+  }
 
-  StatPiece methods{known_methods, default_method};
-  StatPiece uris{known_uris, default_uri};
+  void Merge(const StatPiece& other) {
+    for (size_t i = 0; i < counts.size(); ++i) {
+      counts[i] += other.counts[i];
+    }
+  }
+
+  map<string_view, uint64_t> GetValues() const {
+    map<string_view, uint64_t> result;
+    for (size_t i = 0; i < counts.size(); ++i) {
+      result[classifier->GetKey(i)] += counts[i];
+    }
+    return result;
+  }
+
+ private:
+  const Classifier* classifier;
+  // the last one counts the values of no key
+  vector<uint64_t> counts;
+};
+
+// Keys requests are counted by
+struct StatsKeys {
+  vector<string> methods = {"GET", "POST", "DELETE", "PUT"};
+  string default_method = "UNKNOWN";
+  vector<string> uris = {"/", "/product", "/basket", "/help", "/order"};
+  string default_uri = "unknown";
+  vector<string> protocols = {"HTTP/1.0", "HTTP/1.1", "HTTP/2"};
+  string default_protocol = "unknown";
+  // URIs are also grouped by the longest of these prefixes
+  vector<string> uri_prefixes;
+  string default_uri_prefix = "other";
+};
+
+// Reads lines "<set> <key>", where set is method, uri, protocol or uri_prefix,
+// or "default_<set> <key>" for the key of values matching none.
+// Keys of a set given replace the built-in ones, empty lines and lines
+// starting with # are skipped. Throws invalid_argument on unknown sets
+StatsKeys ReadStatsKeys(istream& input);
+
+// Classifiers of StatsKeys, shared by all Stats counting by the same keys
+class StatsSchema {
+ public:
+  explicit StatsSchema(StatsKeys keys = {});
+
+  StatsSchema(const StatsSchema&) = delete;
+  StatsSchema& operator=(const StatsSchema&) = delete;
+
+  static shared_ptr<const StatsSchema> GetDefault();
+
+ private:
+  friend class Stats;
+
+  // classifiers refer to these strings
+  const StatsKeys keys;
+  const KeyClassifier methods;
+  const KeyClassifier uris;
+  const KeyClassifier protocols;
+  const PrefixClassifier uri_prefixes;
+};
+
+class Stats {
+ public:
+  explicit Stats(shared_ptr<const StatsSchema> schema = StatsSchema::GetDefault());
+
+  void Add(const HttpRequest& request) {
+    AddMethod(request.method);
+    AddUri(request.uri);
+    AddProtocol(request.protocol);
+  }
+
+  void AddMethod(string_view method) {
+    methods.Add(method);
+  }
+
+  // Counts the uri and its group of uri prefixes
+  void AddUri(string_view uri) {
+    uris.Add(uri);
+    uri_prefixes.Add(uri);
+  }
+
+  void AddProtocol(string_view protocol) {
+    protocols.Add(protocol);
+  }
+
+  // Adds the counts of other, which must have the same schema
+  void Merge(const Stats& other);
+
+  map<string_view, uint64_t> GetMethodStats() const;
+  map<string_view, uint64_t> GetUriStats() const;
+  map<string_view, uint64_t> GetProtocolStats() const;
+  map<string_view, uint64_t> GetUriPrefixStats() const;
+
+ private:
+  shared_ptr<const StatsSchema> schema;
+  StatPiece<KeyClassifier> methods;
+  StatPiece<KeyClassifier> uris;
+  StatPiece<KeyClassifier> protocols;
+  StatPiece<PrefixClassifier> uri_prefixes;
 };
 
 HttpRequest ParseRequest(string_view line);
@@ -1,48 +1,419 @@
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <random>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
+#include "profile.h"
 #include "test_runner.h"
 
+// Text as a balanced tree whose leaves are pieces of immutable strings (a rope).
+// Nodes are never changed, so ropes share them: a split or a concatenation
+// makes O(log n) new nodes and doesn't copy the text
+class Rope {
+ public:
+  // Memory held by some ropes
+  struct Stats {
+    size_t node_count = 0;
+    size_t text_bytes = 0;
+  };
+
+  Rope() = default;
+
+  explicit Rope(std::string text) {
+    const auto data = MakeData(std::move(text));
+    root = Build(data, 0, (data->size() + LEAF_SIZE - 1) / LEAF_SIZE);
+  }
+
+  size_t GetSize() const {
+    return root ? root->size : 0;
+  }
+
+  // [0, position) and [position, GetSize())
+  std::pair<Rope, Rope> Split(size_t position) const {
+    auto [left, right] = Split(root, position);
+    return {Rope(std::move(left)), Rope(std::move(right))};
+  }
+
+  Rope Substr(size_t position, size_t length) const {
+    return Split(position).second.Split(length).first;
+  }
+
+  friend Rope operator+(const Rope& left, const Rope& right) {
+    return Rope(Join(left.root, right.root));
+  }
+
+  std::string ToString() const {
+    std::string result;
+    result.reserve(GetSize());
+    Append(root, result);
+    return result;
+  }
+
+  // Nodes and strings shared by the ropes are counted once.
+  // Takes time proportional to the number of nodes
+  static Stats GetStats(const std::vector<const Rope*>& ropes) {
+    std::unordered_set<const Node*> nodes;
+    std::unordered_set<const std::string*> texts;
+    std::vector<const Node*> stack;
+    for (const Rope* rope : ropes) {
+      if (rope->root) {
+        stack.push_back(rope->root.get());
+      }
+    }
+    Stats result;
+    while (!stack.empty()) {
+      const Node* node = stack.back();
+      stack.pop_back();
+      if (!nodes.insert(node).second) {
+        continue;
+      }
+      if (!node->IsLeaf()) {
+        stack.push_back(node->left.get());
+        stack.push_back(node->right.get());
+      } else if (texts.insert(node->data.get()).second) {
+        result.text_bytes += node->data->size();
+      }
+    }
+    result.node_count = nodes.size();
+    return result;
+  }
+
+ private:
+  struct Node;
+  using NodePtr = std::shared_ptr<const Node>;
+
+  struct Node {
+    // both are empty for a leaf
+    NodePtr left, right;
+    // a leaf holds size characters of data starting at offset
+    std::shared_ptr<const std::string> data;
+    size_t offset = 0;
+    size_t size = 0;
+    int height = 1;
+
+    Node(NodePtr left, NodePtr right, std::shared_ptr<const std::string> data,
+         size_t offset, size_t size, int height)
+      : left(std::move(left))
+      , right(std::move(right))
+      , data(std::move(data))
+      , offset(offset)
+      , size(size)
+      , height(height) {
+    }
+
+    bool IsLeaf() const {
+      return !left;
+    }
+  };
+
+  // pieces of a new text
+  static constexpr size_t LEAF_SIZE = 1024;
+  // leaves joined are merged into one if they are that small together,
+  // so that typing doesn't make a leaf for every character
+  static constexpr size_t MERGED_LEAF_SIZE = 64;
+
+  explicit Rope(NodePtr root) : root(std::move(root)) {}
+
+  static int GetHeight(const NodePtr& node) {
+    return node ? node->height : 0;
+  }
+
+  static std::shared_ptr<const std::string> MakeData(std::string text) {
+    return std::make_shared<const std::string>(std::move(text));
+  }
+
+  static NodePtr MakeLeaf(std::shared_ptr<const std::string> data, size_t offset, size_t size) {
+    return std::make_shared<const Node>(nullptr, nullptr, std::move(data), offset, size, 1);
+  }
+
+  static NodePtr MakeNode(NodePtr left, NodePtr right) {
+    const size_t size = left->size + right->size;
+    const int height = std::max(left->height, right->height) + 1;
+    return std::make_shared<const Node>(std::move(left), std::move(right), nullptr, 0, size, height);
+  }
+
+  // leaves from [first_leaf, last_leaf) of LEAF_SIZE characters of data
+  static NodePtr Build(const std::shared_ptr<const std::string>& data, size_t first_leaf, size_t last_leaf) {
+    if (first_leaf == last_leaf) {
+      return nullptr;
+    }
+    if (last_leaf - first_leaf == 1) {
+      const size_t offset = first_leaf * LEAF_SIZE;
+      return MakeLeaf(data, offset, std::min(LEAF_SIZE, data->size() - offset));
+    }
+    const size_t middle = first_leaf + (last_leaf - first_leaf) / 2;
+    return MakeNode(Build(data, first_leaf, middle), Build(data, middle, last_leaf));
+  }
+
+  // A node over subtrees whose heights differ by at most 2
+  static NodePtr Balance(NodePtr left, NodePtr right) {
+    if (left->height > right->height + 1) {
+      if (GetHeight(left->left) >= GetHeight(left->right)) {
+        return MakeNode(left->left, MakeNode(left->right, std::move(right)));
+      }
+      return MakeNode(MakeNode(left->left, left->right->left),
+                      MakeNode(left->right->right, std::move(right)));
+    }
+    if (right->height > left->height + 1) {
+      if (GetHeight(right->right) >= GetHeight(right->left)) {
+        return MakeNode(MakeNode(std::move(left), right->left), right->right);
+      }
+      return MakeNode(MakeNode(std::move(left), right->left->left),
+                      MakeNode(right->left->right, right->right));
+    }
+    return MakeNode(std::move(left), std::move(right));
+  }
+
+  // Takes O(difference of heights + 1)
+  static NodePtr Join(NodePtr left, NodePtr right) {
+    if (!left) {
+      return right;
+    }
+    if (!right) {
+      return left;
+    }
+    if (left->IsLeaf() && right->IsLeaf() && left->size + right->size <= MERGED_LEAF_SIZE) {
+      std::string text;
+      text.reserve(left->size + right->size);
+      Append(left, text);
+      Append(right, text);
+      const size_t size = text.size();
+      return MakeLeaf(MakeData(std::move(text)), 0, size);
+    }
+    if (left->height > right->height + 1) {
+      return Balance(left->left, Join(left->right, std::move(right)));
+    }
+    if (right->height > left->height + 1) {
+      return Balance(Join(std::move(left), right->left), right->right);
+    }
+    return MakeNode(std::move(left), std::move(right));
+  }
+
+  static std::pair<NodePtr, NodePtr> Split(const NodePtr& node, size_t position) {
+    if (!node || position == 0) {
+      return {nullptr, node};
+    }
+    if (position >= node->size) {
+      return {node, nullptr};
+    }
+    if (node->IsLeaf()) {
+      return {MakeLeaf(node->data, node->offset, position),
+              MakeLeaf(node->data, node->offset + position, node->size - position)};
+    }
+    if (position <= node->left->size) {
+      auto [left, middle] = Split(node->left, position);
+      return {std::move(left), Join(std::move(middle), node->right)};
+    }
+    auto [middle, right] = Split(node->right, position - node->left->size);
+    return {Join(node->left, std::move(middle)), std::move(right)};
+  }
+
+  static void Append(const NodePtr& node, std::string& result) {
+    if (!node) {
+      return;
+    }
+    if (node->IsLeaf()) {
+      result.append(*node->data, node->offset, node->size);
+      return;
+    }
+    Append(node->left, result);
+    Append(node->right, result);
+  }
+
+  NodePtr root;
+};
+
+// Replaces erase_count characters from position with text
+struct TextEdit {
+  size_t position;
+  size_t erase_count;
+  std::string text;
+};
+
+// Changes of the text can be undone and redone. Every version of the text
+// is a rope sharing nodes with the previous one, so a change keeps O(log n)
+// new nodes in the history and undo and redo only swap the roots
 class Editor {
  public:
-  // Реализуйте конструктор по умолчанию и объявленные методы
+  struct Stats {
+    size_t undo_count = 0;
+    size_t redo_count = 0;
+    // of the text, the buffer and the history
+    Rope::Stats memory;
+  };
+
   Editor() = default;
-  void Left()  { shift(left, right); }
-  void Right() { shift(right, left); }
+
+  explicit Editor(std::string text)
+    : text(std::move(text)) {
+  }
+
+  void Left(size_t count = 1) {
+    position -= std::min(count, position);
+  }
+  void Right(size_t count = 1) {
+    position += std::min(count, text.GetSize() - position);
+  }
   void Insert(char token) {
-    left.push_back(token);
+    Insert(Rope(std::string(1, token)));
   }
+  void Insert(std::string tokens) {
+    Insert(Rope(std::move(tokens)));
+  }
+  // Moves up to tokens characters after the cursor to the buffer
   void Cut(size_t tokens = 1) {
-    for (size_t i = 0; i < tokens; ++i)
-      shift(right, buffer);
+    auto [before, rest] = text.Split(position);
+    auto [cut, after] = rest.Split(tokens);
+    if (cut.GetSize() > 0) {
+      Remember();
+      text = before + after;
+    }
+    buffer = std::move(cut);
   }
   void Copy(size_t tokens = 1) {
-      for (size_t i = 0; i < min(tokens, right.size()); ++i)
-        buffer.push_back(right[right.size() - i - 1]);
+    buffer = text.Substr(position, tokens);
   }
+  // The text shares the nodes of the buffer
   void Paste() {
-    for (const char el : buffer)
-        left.push_back(el);
+    Insert(buffer);
   }
   std::string GetText() const {
-    return left + std::string(right.rbegin(), right.rend());
+    return text.ToString();
+  }
+  size_t GetSize() const {
+    return text.GetSize();
   }
 
- private:
-  void shift(std::string& source, std::string& dest) {
-    if (!source.empty()) {
-      char temp = source.back();
-      source.pop_back();
-      dest.push_back(temp);
+  // Applies edits at positions of the current text as one change. Edits must be
+  // sorted by position and not overlap. The new text is made of the pieces
+  // of the old one between edits and of one string holding the inserted texts,
+  // so it takes O(edits * log n) whatever the size of the text.
+  // The cursor stays between the same characters; if they are erased,
+  // it goes to the end of the edit. Returns where every edit ends in the new text
+  std::vector<size_t> Apply(const std::vector<TextEdit>& edits) {
+    if (edits.empty()) {
+      return {};
+    }
+    std::string inserted;
+    size_t end = 0;
+    for (const TextEdit& edit : edits) {
+      if (edit.position < end) {
+        throw std::invalid_argument("edits overlap or aren't sorted");
+      }
+      end = edit.position + edit.erase_count;
+      if (end > text.GetSize()) {
+        throw std::out_of_range("edit beyond the end of the text");
+      }
+      inserted += edit.text;
+    }
+    const Rope insertions(std::move(inserted));
+
+    Rope result, rest = text;
+    std::vector<size_t> ends;
+    ends.reserve(edits.size());
+    // of rest in the old text and of the inserted texts
+    size_t offset = 0, inserted_offset = 0;
+    size_t new_position = position;
+    for (const TextEdit& edit : edits) {
+      auto [kept, tail] = rest.Split(edit.position - offset);
+      rest = tail.Split(edit.erase_count).second;
+      result = result + kept + insertions.Substr(inserted_offset, edit.text.size());
+      offset = edit.position + edit.erase_count;
+      inserted_offset += edit.text.size();
+      ends.push_back(result.GetSize());
+
+      if (offset <= position) {
+        new_position = position - offset + result.GetSize();
+      } else if (edit.position <= position) {
+        // the edit erases a character next to the cursor
+        new_position = result.GetSize();
+      }
+    }
+
+    Remember();
+    text = result + rest;
+    position = new_position;
+    return ends;
+  }
+
+  // Brings back the text and the cursor as they were before the last change,
+  // returns false if there is nothing to undo. The buffer stays as it is
+  bool Undo() {
+    return Restore(undone, redone);
+  }
+  bool Redo() {
+    return Restore(redone, undone);
+  }
+
+  // The oldest changes are forgotten beyond the limit
+  void SetHistoryLimit(size_t limit) {
+    history_limit = limit;
+    Forget();
+  }
+
+  // Takes time proportional to the number of nodes
+  Stats GetStats() const {
+    std::vector<const Rope*> ropes = {&text, &buffer};
+    for (const auto* versions : {&undone, &redone}) {
+      for (const Version& version : *versions) {
+        ropes.push_back(&version.text);
+      }
     }
+    return {undone.size(), redone.size(), Rope::GetStats(ropes)};
   }
 
  private:
-  // left  right
-  // ----> <------
-  // abcde|qwerty
-  std::string left;
-  std::string right;
-  std::string buffer;
+  struct Version {
+    Rope text;
+    size_t position;
+  };
+
+  // Called before every change of the text
+  void Remember() {
+    undone.push_back({text, position});
+    redone.clear();
+    Forget();
+  }
+
+  void Forget() {
+    while (undone.size() > history_limit) {
+      undone.pop_front();
+    }
+  }
+
+  bool Restore(std::deque<Version>& from, std::deque<Version>& to) {
+    if (from.empty()) {
+      return false;
+    }
+    to.push_back({std::move(text), position});
+    text = std::move(from.back().text);
+    position = from.back().position;
+    from.pop_back();
+    return true;
+  }
+
+  void Insert(const Rope& tokens) {
+    if (tokens.GetSize() == 0) {
+      return;
+    }
+    Remember();
+    auto [before, after] = text.Split(position);
+    text = before + tokens + after;
+    position += tokens.GetSize();
+  }
+
+  Rope text;
+  Rope buffer;
+  // characters before the cursor
+  size_t position = 0;
+  std::deque<Version> undone, redone;
+  size_t history_limit = 100'000;
 };
 
 
@@ -135,12 +506,275 @@ void TestEmptyBuffer() {
   ASSERT_EQUAL(editor.GetText(), "example");
 }
 
+void TestMoves() {
+  Editor editor("hello, world");
+  editor.Right(7);
+  editor.Cut(100);
+  editor.Left(100);
+  editor.Paste();
+  editor.Insert(std::string(", "));
+  editor.Right(4);
+  editor.Left(1);
+  editor.Copy(2);
+  editor.Right(100);
+  editor.Paste();
+
+  ASSERT_EQUAL(editor.GetText(), "world, hello, lo");
+  ASSERT_EQUAL(editor.GetSize(), 16u);
+}
+
+void TestRope() {
+  const std::string text(5'000, 'a');
+  Rope rope(text);
+  for (size_t i = 0; i < 40; ++i) {
+    // every concatenation doubles the text, but it shares the nodes of the previous one
+    rope = rope + rope;
+  }
+  auto [left, right] = rope.Substr(1'000, 10'000).Split(4'000);
+  ASSERT_EQUAL(left.ToString(), std::string(4'000, 'a'));
+  ASSERT_EQUAL(right.GetSize(), 6'000u);
+  ASSERT_EQUAL(rope.GetSize(), text.size() << 40);
+  ASSERT_EQUAL((Rope("abc") + Rope() + Rope("def")).Substr(2, 2).ToString(), "cd");
+}
+
+// The text as a plain string, to check the editor against
+class StringEditor {
+ public:
+  void Left(size_t count) {
+    position -= std::min(count, position);
+  }
+  void Right(size_t count) {
+    position += std::min(count, text.size() - position);
+  }
+  void Insert(char token) {
+    text.insert(position++, 1, token);
+  }
+  void Cut(size_t tokens) {
+    buffer = text.substr(position, tokens);
+    text.erase(position, tokens);
+  }
+  void Copy(size_t tokens) {
+    buffer = text.substr(position, tokens);
+  }
+  void Paste() {
+    text.insert(position, buffer);
+    position += buffer.size();
+  }
+
+  std::string text;
+  std::string buffer;
+  size_t position = 0;
+};
+
+// Applies count random edits, moves are up to max_move characters
+template <typename EditorType>
+void EditRandomly(EditorType& editor, size_t count, size_t max_move) {
+  std::mt19937 gen;
+  std::uniform_int_distribution<size_t> move(0, max_move);
+  std::uniform_int_distribution<size_t> tokens(0, 1'000);
+  for (size_t i = 0; i < count; ++i) {
+    switch (gen() % 6) {
+      case 0: editor.Left(move(gen)); break;
+      case 1: editor.Right(move(gen)); break;
+      case 2: editor.Insert(static_cast<char>('a' + gen() % 26)); break;
+      case 3: editor.Cut(tokens(gen)); break;
+      case 4: editor.Copy(tokens(gen)); break;
+      case 5: editor.Paste(); break;
+    }
+  }
+}
+
+void TestMatchesString() {
+  StringEditor expected;
+  expected.text = std::string(10'000, 'x');
+  EditRandomly(expected, 20'000, 3'000);
+
+  Editor editor(std::string(10'000, 'x'));
+  EditRandomly(editor, 20'000, 3'000);
+  ASSERT_EQUAL(editor.GetText(), expected.text);
+}
+
+void TestUndo() {
+  Editor editor;
+  ASSERT(!editor.Undo());
+
+  TypeText(editor, "hello");
+  editor.Left(5);
+  editor.Cut(2);
+  editor.Right(100);
+  editor.Paste();
+  ASSERT_EQUAL(editor.GetText(), "llohe");
+
+  ASSERT(editor.Undo());
+  ASSERT_EQUAL(editor.GetText(), "llo");
+  ASSERT(editor.Undo());
+  ASSERT_EQUAL(editor.GetText(), "hello");
+  // the cursor comes back too
+  editor.Insert('>');
+  ASSERT_EQUAL(editor.GetText(), ">hello");
+  // a change drops the undone versions
+  ASSERT(!editor.Redo());
+  ASSERT(editor.Undo());
+  ASSERT(editor.Redo());
+  ASSERT_EQUAL(editor.GetText(), ">hello");
+
+  // moves and copies don't change the text, so they aren't undone
+  editor.Copy(3);
+  editor.Left();
+  editor.Cut(0);
+  ASSERT_EQUAL(editor.GetStats().undo_count, 6u);
+  while (editor.Undo()) {
+  }
+  ASSERT_EQUAL(editor.GetText(), "");
+  ASSERT_EQUAL(editor.GetStats().redo_count, 6u);
+
+  while (editor.Redo()) {
+  }
+  editor.SetHistoryLimit(2);
+  ASSERT_EQUAL(editor.GetStats().undo_count, 2u);
+  ASSERT(editor.Undo());
+  ASSERT(editor.Undo());
+  ASSERT(!editor.Undo());
+  ASSERT_EQUAL(editor.GetText(), "hell");
+}
+
+void TestHistoryMemory() {
+  const size_t edit_count = 10'000;
+  const std::string text(1'000'000, 'x');
+  Editor editor(text);
+  const Rope::Stats before = editor.GetStats().memory;
+  EditRandomly(editor, edit_count, text.size());
+  const Editor::Stats stats = editor.GetStats();
+  const std::string edited = editor.GetText();
+
+  // a 1 MB text is a tree of height about 15, and an edit keeps
+  // the nodes along a few paths of it. Snapshots would take 10 GB
+  ASSERT((stats.memory.node_count - before.node_count) / stats.undo_count < 60);
+  ASSERT(stats.memory.text_bytes - before.text_bytes < 64 * stats.undo_count);
+
+  while (editor.Undo()) {
+  }
+  ASSERT_EQUAL(editor.GetText(), text);
+  while (editor.Redo()) {
+  }
+  ASSERT_EQUAL(editor.GetText(), edited);
+  ASSERT_EQUAL(editor.GetStats().undo_count, stats.undo_count);
+
+  // other editors don't count
+  const Editor other("abc");
+  ASSERT_EQUAL(other.GetStats().memory.node_count, 1u);
+  ASSERT_EQUAL(other.GetStats().memory.text_bytes, 3u);
+}
+
+void TestApply() {
+  Editor editor("int a = f(a, b);");
+  editor.Right(13);
+  const auto ends = editor.Apply({{4, 1, "x"}, {10, 1, "x"}, {13, 0, " "}, {13, 1, "c"}});
+  ASSERT_EQUAL(editor.GetText(), "int x = f(x,  c);");
+  ASSERT_EQUAL(ends, (std::vector<size_t>{5, 11, 14, 15}));
+  // the cursor was before "b", which is erased, so it is at the end of that edit
+  editor.Insert('|');
+  ASSERT_EQUAL(editor.GetText(), "int x = f(x,  c|);");
+
+  // a batch is undone at once
+  editor.Undo();
+  editor.Undo();
+  ASSERT_EQUAL(editor.GetText(), "int a = f(a, b);");
+
+  try {
+    editor.Apply({{5, 2, ""}, {6, 0, "y"}});
+    ASSERT(false);
+  } catch (std::invalid_argument&) {
+  }
+  try {
+    editor.Apply({{10, 7, ""}});
+    ASSERT(false);
+  } catch (std::out_of_range&) {
+  }
+  ASSERT_EQUAL(editor.GetText(), "int a = f(a, b);");
+  ASSERT_EQUAL(editor.GetStats().undo_count, 0u);
+
+  // the cursor stays between characters that are kept,
+  // after the text inserted between them
+  Editor kept("ab");
+  kept.Right(1);
+  kept.Apply({{0, 0, "<"}, {1, 0, "_"}, {2, 0, ">"}});
+  kept.Insert('|');
+  ASSERT_EQUAL(kept.GetText(), "<a_|b>");
+}
+
+// count edits sorted by position, of up to 10 characters each
+std::vector<TextEdit> GenerateEdits(size_t text_size, size_t count) {
+  std::mt19937 gen;
+  std::vector<size_t> positions(count);
+  for (size_t& position : positions) {
+    position = gen() % text_size;
+  }
+  std::sort(positions.begin(), positions.end());
+  std::vector<TextEdit> edits;
+  size_t end = 0;
+  for (size_t position : positions) {
+    if (position < end) {
+      continue;
+    }
+    const size_t erase_count = std::min<size_t>(gen() % 10, text_size - position);
+    edits.push_back({position, erase_count, std::string(gen() % 10, static_cast<char>('a' + gen() % 26))});
+    end = position + erase_count;
+  }
+  return edits;
+}
+
+void TestApplyMatchesString() {
+  std::string expected(100'000, 'x');
+  const auto edits = GenerateEdits(expected.size(), 5'000);
+  Editor editor(expected);
+  editor.Apply(edits);
+  for (auto edit = edits.rbegin(); edit != edits.rend(); ++edit) {
+    expected.replace(edit->position, edit->erase_count, edit->text);
+  }
+  ASSERT_EQUAL(editor.GetText(), expected);
+}
+
+void TestApplySpeed() {
+  for (size_t text_size : {10'000'000, 100'000'000}) {
+    Editor editor(std::string(text_size, 'x'));
+    const auto edits = GenerateEdits(text_size, 100'000);
+    LOG_DURATION(std::to_string(edits.size()) + " edits of " + std::to_string(text_size / 1'000'000) + " MB");
+    editor.Apply(edits);
+  }
+}
+
+void TestSpeed() {
+  std::string text(100'000'000, 'x');
+  Editor editor;
+  {
+    LOG_DURATION("100 MB document");
+    editor = Editor(std::move(text));
+  }
+  {
+    LOG_DURATION("10^6 random edits");
+    EditRandomly(editor, 1'000'000, 100'000'000);
+  }
+  const Editor::Stats stats = editor.GetStats();
+  std::cerr << editor.GetSize() << " characters, " << stats.undo_count << " changes to undo in "
+            << stats.memory.node_count << " nodes" << std::endl;
+}
+
 int main() {
   TestRunner tr;
   RUN_TEST(tr, TestEditing);
   RUN_TEST(tr, TestReverse);
   RUN_TEST(tr, TestNoText);
   RUN_TEST(tr, TestEmptyBuffer);
+  RUN_TEST(tr, TestMoves);
+  RUN_TEST(tr, TestRope);
+  RUN_TEST(tr, TestMatchesString);
+  RUN_TEST(tr, TestUndo);
+  RUN_TEST(tr, TestHistoryMemory);
+  RUN_TEST(tr, TestApply);
+  RUN_TEST(tr, TestApplyMatchesString);
+  // RUN_TEST(tr, TestSpeed);
+  // RUN_TEST(tr, TestApplySpeed);
   return 0;
 }
 